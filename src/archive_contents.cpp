@@ -46,28 +46,11 @@ void ReadArchiveFunction(ClientContext &context, TableFunctionInput &data,
   idx_t size = handle->GetFileSize();
   idx_t count = 0;
 
-  struct archive *archive = archive_read_new();
+  struct archive *archive = nullptr;
   try {
-    if (archive_read_support_filter_all(archive)) {
-      throw IOException("Failed to init libarchive (filter all): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_support_format_all(archive)) {
-      throw IOException("Failed to init libarchive (format all): %s",
-                        archive_error_string(archive));
-    }
-    unique_ptr<LibArchiveHandle> zipHandle =
-        make_uniq<LibArchiveHandle>(std::move(handle));
-    // TODO: Add skip?
-    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-      throw IOException("Failed to init libarchive (seek callback): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-      throw IOException("Failed to init libarchive (read callback): %s",
-                        archive_error_string(archive));
-    }
+    unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+        std::move(handle), GetBoolSetting(context, "zipfs_mmap", false));
+    archive = OpenLibArchive(*zipHandle, false);
     struct archive_entry *entry = archive_entry_new2(archive);
     try {
       while (archive_read_next_header2(archive, entry) == ARCHIVE_OK) {
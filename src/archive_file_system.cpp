@@ -1,4 +1,9 @@
 #include "archive_file_system.hpp"
+#include "buffer_pool.hpp"
+#include "archive_glob.hpp"
+#include "parallel_inflate.hpp"
+#include "parallel_part_reader.hpp"
+#include "zip_decompressor.hpp"
 
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/numeric_utils.hpp"
@@ -8,6 +13,13 @@
 
 #ifdef ENABLE_LIBARCHIVE
 
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace duckdb {
 
 auto const ZIP_SEPARATOR = "/";
@@ -92,8 +104,329 @@ static pair<string, string> SplitArchivePath(const string &path,
 // Zip File Handle
 //------------------------------------------------------------------------------
 
+ArchiveFileHandle::~ArchiveFileHandle() { FreeArchive(); }
+
 void ArchiveFileHandle::Close() {}
 
+void ArchiveFileHandle::FreeArchive() {
+  if (entry) {
+    archive_entry_free(entry);
+    entry = nullptr;
+  }
+  if (archive) {
+    archive_read_free(archive);
+    archive = nullptr;
+  }
+  archive_handle.reset();
+}
+
+bool ArchiveFileHandle::LoadFromCache() {
+  if (cache_key.empty()) {
+    return false;
+  }
+  auto cached = entry_cache->Get(cache_key);
+  if (!cached) {
+    return false;
+  }
+  // Unless the buffer manager evicted it since it was cached
+  auto cached_pin = cached->Pin();
+  if (!cached_pin.IsValid()) {
+    return false;
+  }
+  data = std::move(cached);
+  pin = std::move(cached_pin);
+  sz = data->size;
+  size_known = true;
+  FreeArchive();
+  loaded = true;
+  return true;
+}
+
+void ArchiveFileHandle::Load() {
+  lock_guard<mutex> guard(load_lock);
+  if (loaded || LoadFromCache()) {
+    return;
+  }
+  if (DecompressPartsInParallel() || InflateGzipInParallel()) {
+    // Decompressed without libarchive
+  } else if (size_known && spill.ShouldSpill(sz)) {
+    spill_file = make_uniq<SpillFile>(spill);
+    SpillArchiveEntry(archive, *spill_file);
+  } else {
+    bool complete;
+    data = ReadArchiveEntryFully(buffer_manager, archive, entry, pin,
+                                 spill.MaxInMemorySize(), complete);
+    if (!complete) {
+      // Larger than its header said, or its size is unknown (for example a
+      // gzip file): move what has been read so far to disk
+      spill_file = make_uniq<SpillFile>(spill);
+      spill_file->Append(pin.Ptr(), data->size);
+      pin.Destroy();
+      data.reset();
+      SpillArchiveEntry(archive, *spill_file);
+    }
+  }
+  if (!size_known) {
+    sz = data ? data->size : spill_file->GetSize();
+  }
+  FreeArchive();
+  if (data && !cache_key.empty()) {
+    entry_cache->Put(cache_key, data, cache_size);
+  }
+  loaded = true;
+}
+
+bool ArchiveFileHandle::DecompressPartsInParallel() {
+  if (part_threads <= 1) {
+    return false;
+  }
+  auto &inner_handle = *archive_handle->inner_handle;
+  // libarchive has read the start of the file, which it reads on from if
+  // this fails
+  auto position = inner_handle.SeekPosition();
+  ParallelPartReader reader(buffer_manager, inner_handle, part_threads,
+                            spill.MaxInMemorySize());
+  if (!reader.Start()) {
+    inner_handle.Seek(position);
+    return false;
+  }
+  // Read into a buffer that doubles in size as it fills, as when the size is
+  // unknown, moving it to disk once it grows too large
+  idx_t size = 0;
+  data = DecompressedEntry::Allocate(buffer_manager, BLOCK_SIZE, pin);
+  auto complete = reader.Read([&](const data_t *buffer, idx_t nr_bytes) {
+    if (spill_file) {
+      spill_file->Append(buffer, nr_bytes);
+      return;
+    }
+    if (size + nr_bytes > spill.MaxInMemorySize()) {
+      spill_file = make_uniq<SpillFile>(spill);
+      spill_file->Append(pin.Ptr(), size);
+      spill_file->Append(buffer, nr_bytes);
+      pin.Destroy();
+      data.reset();
+      return;
+    }
+    if (size + nr_bytes > data->size) {
+      data->Resize(MaxValue(data->size * 2, size + nr_bytes));
+    }
+    memcpy(pin.Ptr() + size, buffer, nr_bytes);
+    size += nr_bytes;
+  });
+  if (!complete) {
+    // A part too large to hold, so the whole file is left to libarchive
+    inner_handle.Seek(position);
+    spill_file.reset();
+    pin.Destroy();
+    data.reset();
+    return false;
+  }
+  if (data) {
+    data->Resize(size);
+  }
+  return true;
+}
+
+bool ArchiveFileHandle::InflateGzipInParallel() {
+  if (inflate_threads <= 1) {
+    return false;
+  }
+  auto &inner_handle = *archive_handle->inner_handle;
+  auto comp_size = inner_handle.GetFileSize();
+  if (!CanInflateInParallel(comp_size, inflate_threads)) {
+    return false;
+  }
+  // libarchive has read the start of the file, which it reads on from if
+  // this fails
+  auto position = inner_handle.SeekPosition();
+  // Only the header and trailer are read until the file is known to qualify.
+  // Headers which do not fit in the probe, with long names or extra fields,
+  // are left to libarchive.
+  data_t probe[GZIP_PROBE_SIZE];
+  auto probe_size = MinValue<idx_t>(comp_size, GZIP_PROBE_SIZE);
+  inner_handle.Read(probe, probe_size, 0);
+  idx_t header_size;
+  if (!ParseGzipHeader(probe, probe_size, header_size) ||
+      header_size > probe_size) {
+    inner_handle.Seek(position);
+    return false;
+  }
+  data_t trailer[8];
+  inner_handle.Read(trailer, sizeof(trailer), comp_size - sizeof(trailer));
+  // The size modulo 2^32, little endian
+  uint32_t uncomp_size = 0;
+  for (idx_t i = 0; i < 4; i++) {
+    uncomp_size |= uint32_t(trailer[4 + i]) << (8 * i);
+  }
+  if (spill.ShouldSpill(uncomp_size)) {
+    inner_handle.Seek(position);
+    return false;
+  }
+  // The whole compressed file is held while inflating, so it counts towards
+  // the memory limit too
+  BufferHandle comp_pin;
+  try {
+    comp_pin = buffer_manager.Allocate(MemoryTag::EXTENSION, comp_size);
+  } catch (OutOfMemoryException &ex) {
+    inner_handle.Seek(position);
+    return false;
+  }
+  auto comp_data = comp_pin.Ptr();
+  inner_handle.Read(comp_data, comp_size, 0);
+  inner_handle.Seek(position);
+  GzipMember member;
+  if (!ParseGzipMember(comp_data, comp_size, member)) {
+    return false;
+  }
+  data = DecompressedEntry::Allocate(buffer_manager, member.uncomp_size, pin);
+  // Files of several members, or over 4 GiB which the trailer's size does
+  // not hold, fail here and are left to libarchive, as are invalid files,
+  // which it reports
+  if (!ParallelInflate(buffer_manager, comp_data + member.data_offset,
+                       member.data_size, pin.Ptr(), member.uncomp_size,
+                       inflate_threads) ||
+      ZipCrc32(pin.Ptr(), member.uncomp_size) != member.crc32) {
+    pin.Destroy();
+    data.reset();
+    return false;
+  }
+  return true;
+}
+
+bool ArchiveFileHandle::ReadStream(void *buffer, idx_t nr_bytes,
+                                   idx_t location, idx_t &read_bytes) {
+  lock_guard<mutex> guard(load_lock);
+  if (loaded || stream_buffer_size == 0) {
+    return false;
+  }
+  if (location + stream_buffer_size < stream_pos) {
+    // Too far back: decompress the whole file from the start instead
+    RestartArchive();
+    stream_buffer_size = 0;
+    stream_buffer.reset();
+    return false;
+  }
+  if (!stream_buffer) {
+    if (LoadFromCache()) {
+      // Read from memory rather than decompressing again
+      return false;
+    }
+    stream_buffer = BufferPool::Get().Allocate(stream_buffer_size);
+  }
+  auto out = static_cast<data_t *>(buffer);
+  read_bytes = 0;
+  while (read_bytes < nr_bytes) {
+    auto pos = location + read_bytes;
+    if (pos >= stream_pos) {
+      if (!AdvanceStream()) {
+        break;
+      }
+      continue;
+    }
+    // Up to the end of the output so far, or of the buffer
+    auto offset = pos % stream_buffer_size;
+    auto count = MinValue(MinValue(stream_pos - pos, nr_bytes - read_bytes),
+                          stream_buffer_size - offset);
+    memcpy(out + read_bytes, stream_buffer.get() + offset, count);
+    read_bytes += count;
+  }
+  return true;
+}
+
+bool ArchiveFileHandle::SizeStream() {
+  lock_guard<mutex> guard(load_lock);
+  if (loaded || stream_buffer_size == 0) {
+    return false;
+  }
+  idx_t counted_size;
+  if (!size_known && !cache_key.empty() &&
+      entry_cache->GetSize(cache_key, counted_size)) {
+    sz = counted_size;
+    size_known = true;
+  }
+  if (!size_known && LoadFromCache()) {
+    return true;
+  }
+  if (!size_known) {
+    if (!stream_buffer) {
+      stream_buffer = BufferPool::Get().Allocate(stream_buffer_size);
+    }
+    while (AdvanceStream()) {
+    }
+    // Reads start from the beginning again
+    RestartArchive();
+    if (!cache_key.empty()) {
+      entry_cache->PutSize(cache_key, sz);
+    }
+  }
+  return true;
+}
+
+bool ArchiveFileHandle::AdvanceStream() {
+  auto offset = stream_pos % stream_buffer_size;
+  // At most a quarter of the buffer, so most of the output just before
+  // stream_pos stays in it
+  auto size = MinValue(STREAM_READ_SIZE,
+                       MaxValue<idx_t>(stream_buffer_size / 4, 1));
+  auto read = archive_read_data(archive, stream_buffer.get() + offset,
+                                MinValue(stream_buffer_size - offset, size));
+  if (read < 0) {
+    throw IOException("Failed to read: %s", archive_error_string(archive));
+  }
+  if (read == 0) {
+    if (!size_known) {
+      sz = stream_pos;
+      size_known = true;
+    }
+    return false;
+  }
+  stream_pos += UnsafeNumericCast<idx_t>(read);
+  return true;
+}
+
+void ArchiveFileHandle::RestartArchive() {
+  archive_entry_free(entry);
+  entry = nullptr;
+  archive_read_free(archive);
+  archive = nullptr;
+  archive_handle->Seek(0, SEEK_SET);
+  archive = OpenRawArchive(*archive_handle, entry);
+  stream_pos = 0;
+}
+
+idx_t ArchiveFileHandle::GetSize() {
+  if (seekable) {
+    return seekable->GetSize();
+  }
+  if (!size_known && !loaded && !SizeStream()) {
+    Load();
+  }
+  return sz;
+}
+
+idx_t ArchiveFileHandle::ReadAt(void *buffer, idx_t nr_bytes,
+                                idx_t location) {
+  if (seekable) {
+    return seekable->ReadAt(buffer, nr_bytes, location);
+  }
+  idx_t read_bytes;
+  if (!loaded && ReadStream(buffer, nr_bytes, location, read_bytes)) {
+    return read_bytes;
+  }
+  if (!loaded) {
+    Load();
+  }
+  if (location >= sz) {
+    return 0;
+  }
+  auto to_read = MinValue(nr_bytes, sz - location);
+  if (spill_file) {
+    return spill_file->ReadAt(buffer, to_read, location);
+  }
+  memcpy(buffer, pin.Ptr() + location, to_read);
+  return to_read;
+}
+
 //------------------------------------------------------------------------------
 // Zip File System
 //------------------------------------------------------------------------------
@@ -103,14 +436,124 @@ bool ArchiveFileSystem::CanHandleFile(const string &fpath) {
   return fpath.size() > 10 && fpath.substr(0, 10) == "archive://";
 }
 
+LibArchiveHandle::LibArchiveHandle(unique_ptr<FileHandle> inner_handle_p,
+                                   bool map_file)
+    : inner_handle(std::move(inner_handle_p)), data_len(0),
+      read_size(ARCHIVE_READ_MIN_SIZE), mapping(nullptr), mapping_size(0),
+      mapping_pos(0) {
+  if (map_file) {
+    MapFile();
+  }
+}
+
+LibArchiveHandle::~LibArchiveHandle() {
+#ifndef __EMSCRIPTEN__
+  if (mapping) {
+    munmap(mapping, mapping_size);
+  }
+#endif
+}
+
+void LibArchiveHandle::MapFile() {
+#ifndef __EMSCRIPTEN__
+  // Other file systems may report files on disk, e.g. when decompressing
+  // them, so only files read as they are on disk are mapped
+  if (!inner_handle->OnDiskFile() ||
+      inner_handle->file_system.GetName() != "LocalFileSystem") {
+    return;
+  }
+  auto size = inner_handle->GetFileSize();
+  if (size == 0) {
+    return;
+  }
+  // Failing to map the file just means reading it
+  int fd = open(inner_handle->GetPath().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  void *ptr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && idx_t(st.st_size) == size) {
+    ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    return;
+  }
+  madvise(ptr, size, MADV_SEQUENTIAL);
+  mapping = static_cast<data_t *>(ptr);
+  mapping_size = size;
+  mapping_pos = inner_handle->SeekPosition();
+#endif
+}
+
+la_ssize_t LibArchiveHandle::Read(const void **buffer) {
+  if (mapping) {
+    // All of the rest of the file, which libarchive reads in place
+    *buffer = mapping + mapping_pos;
+    auto read = MinValue<idx_t>(mapping_size - mapping_pos,
+                                NumericLimits<la_ssize_t>::Maximum());
+    mapping_pos += read;
+    return UnsafeNumericCast<la_ssize_t>(read);
+  }
+  if (data_len < read_size) {
+    data = BufferPool::Get().Allocate(read_size);
+    data_len = read_size;
+  }
+  auto read = inner_handle->Read(data.get(), read_size);
+  read_size = MinValue(read_size * 2, ARCHIVE_READ_MAX_SIZE);
+  *buffer = data.get();
+  return UnsafeNumericCast<la_ssize_t>(read);
+}
+
+la_int64_t LibArchiveHandle::Seek(la_int64_t offset, int whence) {
+  idx_t position = mapping ? mapping_pos : inner_handle->SeekPosition();
+  idx_t size = mapping ? mapping_size : inner_handle->GetFileSize();
+  la_int64_t target;
+  if (whence == SEEK_SET) {
+    target = offset;
+  } else if (whence == SEEK_CUR) {
+    target = UnsafeNumericCast<la_int64_t>(position) + offset;
+  } else if (whence == SEEK_END) {
+    target = UnsafeNumericCast<la_int64_t>(size) + offset;
+  } else {
+    return ARCHIVE_FATAL;
+  }
+  if (target < 0) {
+    return ARCHIVE_FATAL;
+  }
+  if (mapping) {
+    mapping_pos = MinValue(UnsafeNumericCast<idx_t>(target), mapping_size);
+  } else {
+    inner_handle->Seek(UnsafeNumericCast<idx_t>(target));
+    // Reads after a seek are likely followed by another seek
+    read_size = ARCHIVE_READ_MIN_SIZE;
+  }
+  return target;
+}
+
+la_int64_t LibArchiveHandle::Skip(la_int64_t request) {
+  if (request <= 0) {
+    return 0;
+  }
+  idx_t position = mapping ? mapping_pos : inner_handle->SeekPosition();
+  idx_t size = mapping ? mapping_size : inner_handle->GetFileSize();
+  auto skip = MinValue(UnsafeNumericCast<idx_t>(request),
+                       size - MinValue(position, size));
+  if (mapping) {
+    mapping_pos += skip;
+  } else {
+    inner_handle->Seek(position + skip);
+    read_size = ARCHIVE_READ_MIN_SIZE;
+  }
+  return UnsafeNumericCast<la_int64_t>(skip);
+}
+
 /* Returns pointer and size of next block of data from archive. */
 la_ssize_t FileSystemZipReadFunc(struct archive *archive, void *clientData,
                                  const void **buffer) {
   LibArchiveHandle *handle = (LibArchiveHandle *)clientData;
-  auto readBytes =
-      handle->inner_handle->Read(handle->data.get(), handle->data_len);
-  *buffer = handle->data.get();
-  return UnsafeNumericCast<la_ssize_t>(readBytes);
+  return handle->Read(buffer);
 }
 
 /* Seeks to specified location in the file and returns the position.
@@ -120,16 +563,16 @@ la_ssize_t FileSystemZipReadFunc(struct archive *archive, void *clientData,
 la_int64_t FileSystemZipSeekFunc(struct archive *archive, void *clientData,
                                  la_int64_t offset, int whence) {
   LibArchiveHandle *handle = (LibArchiveHandle *)clientData;
-  if (whence == SEEK_SET) {
-    handle->inner_handle->Seek(offset);
-  } else if (whence == SEEK_CUR) {
-    handle->inner_handle->Seek(handle->inner_handle->SeekPosition() + offset);
-  } else if (whence == SEEK_END) {
-    handle->inner_handle->Seek(handle->inner_handle->GetFileSize() + offset);
-  } else {
-    return ARCHIVE_FATAL;
-  }
-  return ARCHIVE_OK;
+  return handle->Seek(offset, whence);
+}
+
+/* Skips over request bytes of the archive, such as the data of entries which
+ * are not read, and returns how many bytes were skipped.
+ */
+la_int64_t FileSystemZipSkipFunc(struct archive *archive, void *clientData,
+                                 la_int64_t request) {
+  LibArchiveHandle *handle = (LibArchiveHandle *)clientData;
+  return handle->Skip(request);
 }
 
 int FileSystemZipOpenFunc(struct archive *archive, void *clientData) {
@@ -140,49 +583,107 @@ int FileSystemZipCloseFunc(struct archive *archive, void *clientData) {
   return ARCHIVE_OK;
 }
 
-void ReadArchiveEntryFully(struct archive *archive, struct archive_entry *entry,
-                           unique_ptr<data_t[]> *out_data,
-                           la_int64_t *out_size) {
+struct archive *OpenLibArchive(LibArchiveHandle &handle, bool raw_format) {
+  struct archive *archive = archive_read_new();
+  try {
+    if (archive_read_support_filter_all(archive)) {
+      throw IOException("Failed to init libarchive (filter all): %s",
+                        archive_error_string(archive));
+    }
+    if (raw_format) {
+      if (archive_read_support_format_raw(archive)) {
+        throw IOException("Failed to init libarchive (format raw): %s",
+                          archive_error_string(archive));
+      }
+    } else if (archive_read_support_format_all(archive)) {
+      throw IOException("Failed to init libarchive (format all): %s",
+                        archive_error_string(archive));
+    }
+    if (archive_read_set_skip_callback(archive, FileSystemZipSkipFunc)) {
+      throw IOException("Failed to init libarchive (skip callback): %s",
+                        archive_error_string(archive));
+    }
+    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
+      throw IOException("Failed to init libarchive (seek callback): %s",
+                        archive_error_string(archive));
+    }
+    if (archive_read_open(archive, &handle, &FileSystemZipOpenFunc,
+                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
+      throw IOException("Failed to init libarchive (read callback): %s",
+                        archive_error_string(archive));
+    }
+    return archive;
+  } catch (Exception &ex) {
+    archive_read_free(archive);
+    throw;
+  }
+}
 
+shared_ptr<DecompressedEntry>
+ReadArchiveEntryFully(BufferManager &buffer_manager, struct archive *archive,
+                      struct archive_entry *entry, BufferHandle &pin,
+                      idx_t max_size, bool &complete) {
+  complete = true;
   if (archive_entry_size_is_set(entry)) {
-    *out_size = archive_entry_size(entry);
-    *out_data = make_uniq_array2<data_t>(*out_size);
+    auto size = UnsafeNumericCast<idx_t>(archive_entry_size(entry));
+    auto data = DecompressedEntry::Allocate(buffer_manager, size, pin);
 
-    auto read_bytes = archive_read_data(archive, out_data->get(), *out_size);
-    if (read_bytes < *out_size) {
+    auto read_bytes = archive_read_data(archive, pin.Ptr(), size);
+    if (read_bytes < 0 || UnsafeNumericCast<idx_t>(read_bytes) < size) {
       throw IOException("Failed to read: %s", archive_error_string(archive));
     }
-  } else {
-    *out_size = 0;
-    la_int64_t read = 0;
-
-    std::vector<std::tuple<data_t *, la_int64_t>> blocks;
-    auto data_block = new data_t[BLOCK_SIZE]();
+    return data;
+  }
 
-    while (read = archive_read_data(archive, data_block, BLOCK_SIZE),
-           read > 0) {
-      *out_size += read;
-      blocks.push_back(make_pair(data_block, read));
-      data_block = new data_t[BLOCK_SIZE]();
+  // Unknown size: read into a buffer that doubles in size as it fills
+  idx_t size = 0;
+  auto data = DecompressedEntry::Allocate(buffer_manager, BLOCK_SIZE, pin);
+  while (true) {
+    if (size > max_size) {
+      complete = false;
+      break;
     }
+    if (size == data->size) {
+      data->Resize(data->size * 2);
+    }
+    auto read = archive_read_data(archive, pin.Ptr() + size, data->size - size);
+    if (read < 0) {
+      throw IOException("Failed to read: %s", archive_error_string(archive));
+    }
+    if (read == 0) {
+      break;
+    }
+    size += UnsafeNumericCast<idx_t>(read);
+  }
+  data->Resize(size);
+  return data;
+}
 
-    delete[] data_block;
-
-    *out_data = make_uniq_array2<data_t>(*out_size);
-    la_int64_t offset = 0;
-    for (auto &block_and_size : blocks) {
-      auto block = std::get<0>(block_and_size);
-      auto size = std::get<1>(block_and_size);
-      memcpy((*out_data).get() + offset, block, size);
-      offset += size;
-      delete[] block;
+void SpillArchiveEntry(struct archive *archive, SpillFile &spill_file) {
+  auto buffer = BufferPool::Get().Allocate(SPILL_CHUNK_SIZE);
+  while (true) {
+    auto read = archive_read_data(archive, buffer.get(), SPILL_CHUNK_SIZE);
+    if (read < 0) {
+      throw IOException("Failed to read: %s", archive_error_string(archive));
+    }
+    if (read == 0) {
+      break;
     }
+    spill_file.Append(buffer.get(), UnsafeNumericCast<idx_t>(read));
   }
 }
 
 unique_ptr<FileHandle>
 ArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
                             optional_ptr<FileOpener> opener) {
+  return OpenFileExtended(OpenFileInfo(path), flags, opener);
+}
+
+unique_ptr<FileHandle>
+ArchiveFileSystem::OpenFileExtended(const OpenFileInfo &file,
+                                    FileOpenFlags flags,
+                                    optional_ptr<FileOpener> opener) {
+  const auto &path = file.path;
   if (!flags.OpenForReading() || flags.OpenForWriting()) {
     throw IOException("Archive file system can only open for reading");
   }
@@ -195,7 +696,8 @@ ArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
 
   // Now we need to find the file within the zip file and return out file handle
   auto &fs = FileSystem::GetFileSystem(*context);
-  auto handle = fs.OpenFile(zip_path, flags);
+  // The archive's info from a glob saves fetching it again
+  auto handle = fs.OpenFile(GetArchiveOpenInfo(zip_path, file), flags);
   if (!handle) {
     throw IOException("Failed to open file: %s", zip_path);
   }
@@ -223,29 +725,29 @@ ArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
   auto file_type = fs.GetFileType(*handle);
   auto on_disk_file = handle->OnDiskFile();
 
-  struct archive *archive = archive_read_new();
-  try {
-    if (archive_read_support_filter_all(archive)) {
-      throw IOException("Failed to init libarchive (filter all): %s",
-                        archive_error_string(archive));
+  auto &buffer_manager = BufferManager::GetBufferManager(*context);
+  string cache_key;
+  auto cache_size = GetSizeSetting(*context, "zipfs_entry_cache_size",
+                                   DEFAULT_ENTRY_CACHE_SIZE);
+  if (cache_size > 0) {
+    cache_key = GetArchiveKey(*handle) + "\n" + file_path;
+    auto cached = entry_cache->Get(cache_key);
+    if (cached) {
+      // Unless the buffer manager evicted it since it was cached
+      auto pin = cached->Pin();
+      if (pin.IsValid()) {
+        return make_uniq<ArchiveFileHandle>(
+            *this, path, flags, last_modified_time, has_last_modified_time,
+            file_type, on_disk_file, std::move(cached), std::move(pin));
+      }
     }
+  }
 
-    if (archive_read_support_format_all(archive)) {
-      throw IOException("Failed to init libarchive (format all): %s",
-                        archive_error_string(archive));
-    }
-    unique_ptr<LibArchiveHandle> zipHandle =
-        make_uniq<LibArchiveHandle>(std::move(handle));
-    // TODO: Add skip?
-    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-      throw IOException("Failed to init libarchive (seek callback): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-      throw IOException("Failed to init libarchive (read callback): %s",
-                        archive_error_string(archive));
-    }
+  struct archive *archive = nullptr;
+  try {
+    unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+        std::move(handle), GetBoolSetting(*context, "zipfs_mmap", false));
+    archive = OpenLibArchive(*zipHandle, false);
     struct archive_entry *entry = archive_entry_new2(archive);
     try {
       bool found = false;
@@ -260,18 +762,12 @@ ArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
         throw IOException("Failed to find file: %s", file_path);
       }
 
-      unique_ptr<data_t[]> read_buf;
-      la_int64_t read_buf_size;
-      ReadArchiveEntryFully(archive, entry, &read_buf, &read_buf_size);
-
-      auto zip_file_handle = make_uniq<ArchiveFileHandle>(
+      // The entry is decompressed when first read
+      return make_uniq<ArchiveFileHandle>(
           *this, path, flags, last_modified_time, has_last_modified_time,
-          file_type, on_disk_file, read_buf_size, std::move(read_buf));
-
-      archive_entry_free(entry);
-      archive_read_free(archive);
-
-      return zip_file_handle;
+          file_type, on_disk_file, archive, entry, std::move(zipHandle),
+          entry_cache, cache_key, cache_size, buffer_manager,
+          GetSpillOptions(*context));
     } catch (Exception &ex2) {
       archive_entry_free(entry);
       throw;
@@ -285,25 +781,21 @@ ArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
 void ArchiveFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes,
                              idx_t location) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  auto remaining_bytes = t_handle.sz - location;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + location, to_read);
+  t_handle.ReadAt(buffer, UnsafeNumericCast<idx_t>(nr_bytes), location);
 }
 
 int64_t ArchiveFileSystem::Read(FileHandle &handle, void *buffer,
                                 int64_t nr_bytes) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  auto position = t_handle.seek_offset;
-  auto remaining_bytes = t_handle.sz - position;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + position, to_read);
-  t_handle.seek_offset += to_read;
-  return to_read;
+  auto read_bytes = t_handle.ReadAt(
+      buffer, UnsafeNumericCast<idx_t>(nr_bytes), t_handle.seek_offset);
+  t_handle.seek_offset += read_bytes;
+  return UnsafeNumericCast<int64_t>(read_bytes);
 }
 
 int64_t ArchiveFileSystem::GetFileSize(FileHandle &handle) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  return UnsafeNumericCast<int64_t>(t_handle.sz);
+  return UnsafeNumericCast<int64_t>(t_handle.GetSize());
 }
 
 void ArchiveFileSystem::Seek(FileHandle &handle, idx_t location) {
@@ -366,61 +858,47 @@ vector<OpenFileInfo> ArchiveFileSystem::Glob(const string &path,
 
   Value zipfs_split_value = Value(LogicalType::VARCHAR);
   context->TryGetCurrentSetting("zipfs_split", zipfs_split_value);
+  auto map_file = GetBoolSetting(*context, "zipfs_mmap", false);
 
   auto extension =
       !zipfs_split_value.IsNull() ? zipfs_split_value.GetValue<string>() : "";
 
-  vector<OpenFileInfo> result;
-  for (const auto &curr_zip : matching_zips) {
+  const ArchiveGlob pattern(file_path);
+
+  // Scan archives in parallel, each into its own slot so that the result
+  // keeps the order of matching_zips
+  vector<vector<OpenFileInfo>> archive_results(matching_zips.size());
+  ParallelFor(*context, matching_zips.size(), [&](idx_t zip_idx) {
+    const auto &curr_zip = matching_zips[zip_idx];
+    auto &result = archive_results[zip_idx];
     if (!HasGlob(file_path)) {
       // No glob pattern in the file path, just return the file path
       result.push_back("archive://" + curr_zip.path + extension +
                        ZIP_SEPARATOR + file_path);
-      continue;
+      return;
     }
 
-    auto pattern_parts = StringUtil::Split(file_path, ZIP_SEPARATOR);
     // TODO: We may want to detect globbing into a nested zip file and reject.
 
     // Given the path to the zip file, open it
     auto archive_handle = fs.OpenFile(curr_zip, FileFlags::FILE_FLAGS_READ);
     if (!archive_handle) {
-      continue; // Skip invalid zip files
+      return; // Skip invalid zip files
     }
     if (!archive_handle->CanSeek()) {
-      continue; // Skip unseekable files
+      return; // Skip unseekable files
     }
 
     idx_t size = archive_handle->GetFileSize();
+    auto archive_info = GetArchiveInfo(curr_zip, *archive_handle);
 
-    struct archive *archive = archive_read_new();
+    struct archive *archive = nullptr;
     try {
-      if (archive_read_support_filter_all(archive)) {
-        throw IOException("Failed to init libarchive (filter all): %s",
-                          archive_error_string(archive));
-      }
-      if (archive_read_support_format_all(archive)) {
-        throw IOException("Failed to init libarchive (format all): %s",
-                          archive_error_string(archive));
-      }
-      unique_ptr<LibArchiveHandle> zipHandle =
-          make_uniq<LibArchiveHandle>(std::move(archive_handle));
-      // TODO: Add skip?
-      if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-        throw IOException("Failed to init libarchive (seek callback): %s",
-                          archive_error_string(archive));
-      }
-      if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                            &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-        throw IOException("Failed to init libarchive (read callback): %s",
-                          archive_error_string(archive));
-      }
+      unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+          std::move(archive_handle), map_file);
+      archive = OpenLibArchive(*zipHandle, false);
       struct archive_entry *entry = archive_entry_new2(archive);
       try {
-        string zip_filename;
-        const size_t MAX_FILENAME_LEN = 65536; // = 2**16
-        zip_filename.reserve(1024);
-
         while (archive_read_next_header2(archive, entry) == ARCHIVE_OK) {
           if (archive_entry_mode(entry) & AE_IFDIR) {
             continue;
@@ -431,55 +909,20 @@ vector<OpenFileInfo> ArchiveFileSystem::Glob(const string &path,
           }
 
           auto path_name = archive_entry_pathname(entry);
-          // TODO: May have backed out an optimization here
-          zip_filename = path_name;
-
-          auto entry_parts = StringUtil::Split(zip_filename, '/');
-
-          if (entry_parts.size() < pattern_parts.size()) {
-            // This entry is not deep enough to match the pattern
+          auto &literal_prefix = pattern.GetLiteralPrefix();
+          if (strncmp(path_name, literal_prefix.c_str(),
+                      literal_prefix.size()) != 0) {
             continue;
           }
-
-          // Check if the pattern matches the entry
-          bool match = true;
-          for (idx_t i = 0; i < pattern_parts.size(); i++) {
-            const auto &pp = pattern_parts[i];
-            const auto &ep = entry_parts[i];
-
-            if (pp == "**") {
-              // We only allow crawl's to be at the end of the pattern
-              if (i != pattern_parts.size() - 1) {
-                throw NotImplementedException(
-                    "Recursive globs are only supported at the end of archive "
-                    "file "
-                    "path patterns");
-              }
-              // Otherwise, everything else is a match
-              match = true;
-              break;
-            }
-
-            if (!duckdb::Glob(ep.c_str(), ep.size(), pp.c_str(), pp.size())) {
-              // Not a match
-              match = false;
-              break;
-            }
-
-            if (i == pattern_parts.size() - 1 &&
-                entry_parts.size() > pattern_parts.size()) {
-              // If the entry is deeper than the pattern (and we havent hit a
-              // **), then it is not a match
-              match = false;
-              break;
-            }
-          }
-
-          if (match) {
+          if (pattern.Match(path_name, strlen(path_name))) {
             auto entry_path = "archive://" + curr_zip.path + extension +
-                              ZIP_SEPARATOR + zip_filename;
+                              ZIP_SEPARATOR + path_name;
             // Cache here???
-            result.push_back(entry_path);
+            auto file_size = archive_entry_size_is_set(entry)
+                                 ? Value::UBIGINT(archive_entry_size(entry))
+                                 : Value();
+            result.push_back(
+                MakeArchiveEntryInfo(entry_path, archive_info, file_size));
           }
         }
 
@@ -493,6 +936,12 @@ vector<OpenFileInfo> ArchiveFileSystem::Glob(const string &path,
       archive_read_free(archive);
       throw;
     }
+  });
+
+  vector<OpenFileInfo> result;
+  for (auto &archive_result : archive_results) {
+    result.insert(result.end(), std::make_move_iterator(archive_result.begin()),
+                  std::make_move_iterator(archive_result.end()));
   }
 
   return result;
@@ -527,28 +976,11 @@ bool ArchiveFileSystem::FileExists(const string &filename,
 
   idx_t size = handle->GetFileSize();
 
-  struct archive *archive = archive_read_new();
+  struct archive *archive = nullptr;
   try {
-    if (archive_read_support_filter_all(archive)) {
-      throw IOException("Failed to init libarchive (filter all): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_support_format_all(archive)) {
-      throw IOException("Failed to init libarchive (format all): %s",
-                        archive_error_string(archive));
-    }
-    unique_ptr<LibArchiveHandle> zipHandle =
-        make_uniq<LibArchiveHandle>(std::move(handle));
-    // TODO: Add skip?
-    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-      throw IOException("Failed to init libarchive (seek callback): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-      throw IOException("Failed to init libarchive (read callback): %s",
-                        archive_error_string(archive));
-    }
+    unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+        std::move(handle), GetBoolSetting(*context, "zipfs_mmap", false));
+    archive = OpenLibArchive(*zipHandle, false);
     struct archive_entry *entry = archive_entry_new2(archive);
     try {
       bool found = false;
@@ -0,0 +1,76 @@
+#include "archive_glob.hpp"
+
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/function/scalar/string_common.hpp"
+
+#include <cstring>
+
+namespace duckdb {
+
+ArchiveGlob::ArchiveGlob(const string &pattern) {
+  for (auto &part : StringUtil::Split(pattern, '/')) {
+    Component component;
+    component.recursive = part == "**";
+    component.literal = !component.recursive && !FileSystem::HasGlob(part);
+    if (component.recursive && !components.empty() &&
+        components.back().recursive) {
+      // "**/**" matches the same names as "**"
+      continue;
+    }
+    component.pattern = std::move(part);
+    components.push_back(std::move(component));
+  }
+  // The last component is followed by no '/', so is never part of the prefix
+  for (idx_t i = 0; i + 1 < components.size() && components[i].literal; i++) {
+    literal_prefix += components[i].pattern + "/";
+  }
+}
+
+bool ArchiveGlob::Match(const char *name, idx_t len) const {
+  return MatchFrom(0, name, len, 0);
+}
+
+bool ArchiveGlob::MatchFrom(idx_t component_idx, const char *name, idx_t len,
+                            idx_t pos) const {
+  while (component_idx < components.size()) {
+    auto &component = components[component_idx];
+    if (component.recursive) {
+      // Match no more components, then one more each time round
+      while (true) {
+        if (MatchFrom(component_idx + 1, name, len, pos)) {
+          return true;
+        }
+        if (pos > len) {
+          return false;
+        }
+        auto slash = static_cast<const char *>(
+            memchr(name + pos, '/', len - pos));
+        pos = slash ? idx_t(slash - name) + 1 : len + 1;
+      }
+    }
+    if (pos > len) {
+      return false;
+    }
+    auto slash =
+        static_cast<const char *>(memchr(name + pos, '/', len - pos));
+    idx_t end = slash ? idx_t(slash - name) : len;
+    auto part = name + pos;
+    auto part_len = end - pos;
+    if (component.literal) {
+      if (part_len != component.pattern.size() ||
+          memcmp(part, component.pattern.c_str(), part_len) != 0) {
+        return false;
+      }
+    } else if (!duckdb::Glob(part, part_len, component.pattern.c_str(),
+                             component.pattern.size())) {
+      return false;
+    }
+    component_idx++;
+    pos = end + 1;
+  }
+  // Matched only if the whole name was used up
+  return pos > len;
+}
+
+} // namespace duckdb
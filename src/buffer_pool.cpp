@@ -0,0 +1,147 @@
+#include "buffer_pool.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace duckdb {
+
+// Size of a transparent huge page on x86-64 and most aarch64 kernels
+const idx_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+PooledBuffer::PooledBuffer(PooledBuffer &&other) noexcept
+    : ptr(other.ptr), capacity(other.capacity) {
+  other.ptr = nullptr;
+  other.capacity = 0;
+}
+
+PooledBuffer &PooledBuffer::operator=(PooledBuffer &&other) noexcept {
+  if (this != &other) {
+    reset();
+    ptr = other.ptr;
+    capacity = other.capacity;
+    other.ptr = nullptr;
+    other.capacity = 0;
+  }
+  return *this;
+}
+
+PooledBuffer::~PooledBuffer() { reset(); }
+
+void PooledBuffer::reset() {
+  if (ptr) {
+    BufferPool::Get().Release(ptr, capacity);
+    ptr = nullptr;
+    capacity = 0;
+  }
+}
+
+BufferPool::BufferPool()
+    : idle_size(0), max_idle_size(DEFAULT_BUFFER_POOL_SIZE) {
+  idx_t classes = 0;
+  for (auto size = BUFFER_POOL_MIN_SIZE; size <= BUFFER_POOL_MAX_SIZE;
+       size *= 2) {
+    classes++;
+  }
+  free_buffers.resize(classes);
+}
+
+BufferPool &BufferPool::Get() {
+  // Never destroyed, so buffers can still be released during shutdown
+  static auto pool = new BufferPool();
+  return *pool;
+}
+
+// Index of the smallest size class holding size bytes
+static idx_t GetSizeClass(idx_t size) {
+  idx_t size_class = 0;
+  for (auto class_size = BUFFER_POOL_MIN_SIZE; class_size < size;
+       class_size *= 2) {
+    size_class++;
+  }
+  return size_class;
+}
+
+data_t *BufferPool::AllocateMemory(idx_t capacity) {
+  void *ptr = nullptr;
+#ifdef __linux__
+  if (capacity >= HUGE_PAGE_SIZE) {
+    if (posix_memalign(&ptr, HUGE_PAGE_SIZE, capacity) != 0) {
+      ptr = nullptr;
+    } else {
+      // Only a hint, failure just means regular pages
+      madvise(ptr, capacity, MADV_HUGEPAGE);
+    }
+  } else {
+    ptr = malloc(capacity);
+  }
+#else
+  ptr = malloc(capacity);
+#endif
+  if (!ptr) {
+    throw OutOfMemoryException("Failed to allocate %llu bytes for zipfs",
+                               capacity);
+  }
+  return static_cast<data_t *>(ptr);
+}
+
+void BufferPool::FreeMemory(data_t *ptr) { free(ptr); }
+
+PooledBuffer BufferPool::Allocate(idx_t size) {
+  if (size > BUFFER_POOL_MAX_SIZE) {
+    return PooledBuffer(AllocateMemory(size), size);
+  }
+  auto size_class = GetSizeClass(size);
+  auto capacity = BUFFER_POOL_MIN_SIZE << size_class;
+  {
+    lock_guard<mutex> guard(lock);
+    auto &buffers = free_buffers[size_class];
+    if (!buffers.empty()) {
+      auto ptr = buffers.back();
+      buffers.pop_back();
+      idle_size -= capacity;
+      return PooledBuffer(ptr, capacity);
+    }
+  }
+  return PooledBuffer(AllocateMemory(capacity), capacity);
+}
+
+void BufferPool::Release(data_t *ptr, idx_t capacity) {
+  if (capacity <= BUFFER_POOL_MAX_SIZE) {
+    lock_guard<mutex> guard(lock);
+    if (idle_size + capacity <= max_idle_size) {
+      free_buffers[GetSizeClass(capacity)].push_back(ptr);
+      idle_size += capacity;
+      return;
+    }
+  }
+  FreeMemory(ptr);
+}
+
+void BufferPool::SetMaxIdleSize(idx_t size) {
+  lock_guard<mutex> guard(lock);
+  max_idle_size = size;
+  TrimTo(size);
+}
+
+void BufferPool::Clear() {
+  lock_guard<mutex> guard(lock);
+  TrimTo(0);
+}
+
+void BufferPool::TrimTo(idx_t size) {
+  for (idx_t size_class = free_buffers.size(); size_class > 0; size_class--) {
+    auto &buffers = free_buffers[size_class - 1];
+    auto capacity = BUFFER_POOL_MIN_SIZE << (size_class - 1);
+    while (idle_size > size && !buffers.empty()) {
+      FreeMemory(buffers.back());
+      buffers.pop_back();
+      idle_size -= capacity;
+    }
+  }
+}
+
+} // namespace duckdb
@@ -0,0 +1,56 @@
+#include "clear_cache.hpp"
+#include "buffer_pool.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+struct ClearCacheFunctionData : public GlobalTableFunctionState {
+  ClearCacheFunctionData() : finished(false) {}
+  bool finished;
+};
+
+struct ClearCacheFunctionBindData : public TableFunctionData {
+  shared_ptr<ZipDirectoryCache> directory_cache;
+  shared_ptr<EntryCache> entry_cache;
+};
+
+void ClearCacheFunction(ClientContext &context, TableFunctionInput &data,
+                        DataChunk &output) {
+  auto &bind_data = data.bind_data->Cast<ClearCacheFunctionBindData>();
+  auto &global_data = data.global_state->Cast<ClearCacheFunctionData>();
+  if (global_data.finished) {
+    return;
+  }
+
+  bind_data.directory_cache->Clear();
+  bind_data.entry_cache->Clear();
+  BufferPool::Get().Clear();
+
+  output.SetValue(0, 0, Value::BOOLEAN(true));
+  output.SetCardinality(1);
+  global_data.finished = true;
+}
+
+unique_ptr<FunctionData>
+ClearCacheFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                       vector<LogicalType> &return_types,
+                       vector<string> &names) {
+  auto result = make_uniq<ClearCacheFunctionBindData>();
+  auto &info = input.info->Cast<ClearCacheFunctionInfo>();
+  result->directory_cache = info.directory_cache;
+  result->entry_cache = info.entry_cache;
+
+  return_types.push_back(LogicalType::BOOLEAN);
+  names.emplace_back("success");
+
+  return result;
+}
+
+unique_ptr<GlobalTableFunctionState>
+ClearCacheFunctionInit(ClientContext &context, TableFunctionInitInput &input) {
+  return std::move(make_uniq<ClearCacheFunctionData>());
+}
+
+} // namespace duckdb
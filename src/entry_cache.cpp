@@ -0,0 +1,133 @@
+#include "entry_cache.hpp"
+
+#include "duckdb/common/exception.hpp"
+
+namespace duckdb {
+
+string GetArchiveKey(FileHandle &handle) {
+  auto &fs = handle.file_system;
+  auto key = handle.GetPath() + "\n" + std::to_string(handle.GetFileSize());
+  try {
+    key += "\n" + std::to_string(fs.GetLastModifiedTime(handle).value);
+  } catch (NotImplementedException &ex) {
+    // Size and version tag have to be enough
+  }
+  key += "\n" + fs.GetVersionTag(handle);
+  return key;
+}
+
+DecompressedEntry::DecompressedEntry(BufferManager &buffer_manager, idx_t size,
+                                     BufferHandle &pin)
+    : size(size), buffer_manager(buffer_manager) {
+  // Empty files still get a buffer, so pinning works the same for them
+  pin = buffer_manager.Allocate(MemoryTag::EXTENSION, MaxValue<idx_t>(size, 1));
+  block = pin.GetBlockHandle();
+}
+
+shared_ptr<DecompressedEntry>
+DecompressedEntry::Allocate(BufferManager &buffer_manager, idx_t size,
+                            BufferHandle &pin) {
+  return make_shared_ptr<DecompressedEntry>(buffer_manager, size, pin);
+}
+
+BufferHandle DecompressedEntry::Pin() { return buffer_manager.Pin(block); }
+
+void DecompressedEntry::Resize(idx_t new_size) {
+  buffer_manager.ReAllocate(block, MaxValue<idx_t>(new_size, 1));
+  size = new_size;
+}
+
+shared_ptr<DecompressedEntry> EntryCache::Get(const string &key) {
+  lock_guard<mutex> guard(lock);
+  auto cached = lookup.find(key);
+  if (cached == lookup.end()) {
+    return nullptr;
+  }
+  entries.splice(entries.begin(), entries, cached->second);
+  return cached->second->entry;
+}
+
+void EntryCache::Put(const string &key, shared_ptr<DecompressedEntry> entry,
+                     idx_t memory_limit) {
+  if (entry->size > memory_limit) {
+    return;
+  }
+  lock_guard<mutex> guard(lock);
+  auto cached = lookup.find(key);
+  if (cached != lookup.end()) {
+    memory_usage -= cached->second->entry->size;
+    entries.erase(cached->second);
+    lookup.erase(cached);
+  }
+  memory_usage += entry->size;
+  entries.push_front(CachedEntry{key, std::move(entry)});
+  lookup[key] = entries.begin();
+  EvictToLimit(memory_limit);
+}
+
+void EntryCache::EvictToLimit(idx_t memory_limit) {
+  while (memory_usage > memory_limit && !entries.empty()) {
+    auto &last = entries.back();
+    memory_usage -= last.entry->size;
+    lookup.erase(last.key);
+    entries.pop_back();
+  }
+}
+
+bool EntryCache::GetSize(const string &key, idx_t &size) {
+  lock_guard<mutex> guard(lock);
+  auto cached = sizes.find(key);
+  if (cached == sizes.end()) {
+    return false;
+  }
+  size = cached->second;
+  return true;
+}
+
+void EntryCache::PutSize(const string &key, idx_t size) {
+  lock_guard<mutex> guard(lock);
+  if (sizes.size() >= MAX_CACHED_SIZES) {
+    sizes.clear();
+  }
+  sizes[key] = size;
+}
+
+shared_ptr<const BlockIndex> EntryCache::GetIndex(const string &key) {
+  lock_guard<mutex> guard(lock);
+  auto cached = indexes.find(key);
+  if (cached == indexes.end()) {
+    return nullptr;
+  }
+  return cached->second;
+}
+
+void EntryCache::PutIndex(const string &key,
+                          shared_ptr<const BlockIndex> index) {
+  auto index_size = index->MemoryUsage();
+  if (index_size > MAX_CACHED_INDEX_SIZE) {
+    return;
+  }
+  lock_guard<mutex> guard(lock);
+  if (index_memory_usage + index_size > MAX_CACHED_INDEX_SIZE) {
+    indexes.clear();
+    index_memory_usage = 0;
+  }
+  auto &cached = indexes[key];
+  if (cached) {
+    index_memory_usage -= cached->MemoryUsage();
+  }
+  cached = std::move(index);
+  index_memory_usage += index_size;
+}
+
+void EntryCache::Clear() {
+  lock_guard<mutex> guard(lock);
+  entries.clear();
+  lookup.clear();
+  memory_usage = 0;
+  sizes.clear();
+  indexes.clear();
+  index_memory_usage = 0;
+}
+
+} // namespace duckdb
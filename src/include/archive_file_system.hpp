@@ -7,6 +7,10 @@
 #include <archive.h>
 #include <archive_entry.h>
 #include "utils.hpp"
+#include "entry_cache.hpp"
+#include "spill_file.hpp"
+#include "buffer_pool.hpp"
+#include "seekable_compressed_file.hpp"
 
 namespace duckdb {
 
@@ -16,27 +20,82 @@ la_ssize_t FileSystemZipReadFunc(struct archive *archive, void *clientData,
 la_int64_t FileSystemZipSeekFunc(struct archive *archive, void *clientData,
                                  la_int64_t offset, int whence);
 
+la_int64_t FileSystemZipSkipFunc(struct archive *archive, void *clientData,
+                                 la_int64_t request);
+
 int FileSystemZipOpenFunc(struct archive *archive, void *clientData);
 
 int FileSystemZipCloseFunc(struct archive *archive, void *clientData);
 
-void ReadArchiveEntryFully(struct archive *_a, struct archive_entry *entry,
-                           unique_ptr<data_t[]> *out_data,
-                           la_int64_t *out_size);
+// Read the rest of an entry into a buffer allocated through the buffer
+// manager, pinned by pin. When the entry's size is unknown, reading stops
+// once more than max_size bytes have been read, with complete set to false
+// and the rest of the entry left in archive.
+shared_ptr<DecompressedEntry>
+ReadArchiveEntryFully(BufferManager &buffer_manager, struct archive *archive,
+                      struct archive_entry *entry, BufferHandle &pin,
+                      idx_t max_size, bool &complete);
+
+// Write the rest of an entry to a spill file
+void SpillArchiveEntry(struct archive *archive, SpillFile &spill_file);
+
+class LibArchiveHandle;
+
+// Open the archive read through handle with libarchive, supporting all
+// filters and either all formats or, if raw_format, only the raw format
+struct archive *OpenLibArchive(LibArchiveHandle &handle, bool raw_format);
+
+// Open a compressed file read through handle from its current position with
+// libarchive, setting entry to its only entry, whose data is read next
+struct archive *OpenRawArchive(LibArchiveHandle &handle,
+                               struct archive_entry *&entry);
 
 const size_t BLOCK_SIZE = 1024 * 10;
 
+// Size of the first read from an archive, and after each seek. Reads double in
+// size from there while the archive is read on in order.
+const idx_t ARCHIVE_READ_MIN_SIZE = 64 * 1024;
+const idx_t ARCHIVE_READ_MAX_SIZE = 4 * 1024 * 1024;
+
+// Most output decompressed at a time into the buffer of a streamed
+// compressed:// file
+const idx_t STREAM_READ_SIZE = 1024 * 1024;
+
+// The archive file read by libarchive through its callbacks. With map_file
+// (zipfs_mmap), local files are mapped into memory where possible, so
+// libarchive reads them in place; others are read in order into a buffer.
+// Mapping is opt-in as a mapped file truncated while it is read raises
+// SIGBUS rather than a read error.
 class LibArchiveHandle final {
 public:
-  LibArchiveHandle(unique_ptr<FileHandle> inner_handle_p)
-      : inner_handle(std::move(inner_handle_p)) {
-    data = make_uniq_array2<data_t>(BLOCK_SIZE);
-    data_len = BLOCK_SIZE;
-  }
+  LibArchiveHandle(unique_ptr<FileHandle> inner_handle_p, bool map_file);
+  ~LibArchiveHandle();
+
+  // Set buffer to the next data from the archive, returning its size, or 0
+  // at the end
+  la_ssize_t Read(const void **buffer);
+  // Move to offset from whence (SEEK_SET, SEEK_CUR or SEEK_END), returning
+  // the new position, or ARCHIVE_FATAL
+  la_int64_t Seek(la_int64_t offset, int whence);
+  // Move request bytes forward without reading them, returning how far it
+  // moved, which is less at the end of the file
+  la_int64_t Skip(la_int64_t request);
 
   unique_ptr<FileHandle> inner_handle;
-  unique_ptr<data_t[]> data;
-  size_t data_len;
+
+private:
+  // Map the inner file into memory, if it is a local file
+  void MapFile();
+
+  PooledBuffer data;
+  idx_t data_len;
+  // Size of the next read, when not mapped
+  idx_t read_size;
+
+  // The whole file when mapped, and the position read up to in it
+  data_t *mapping;
+  idx_t mapping_size;
+  idx_t mapping_pos;
 };
 
 class ArchiveFileHandle final : public FileHandle {
@@ -44,32 +103,146 @@ class ArchiveFileHandle final : public FileHandle {
   friend class RawArchiveFileSystem;
 
 public:
+  // Takes ownership of archive and entry, positioned at the entry to read
   ArchiveFileHandle(FileSystem &file_system, const string &path,
                     FileOpenFlags flags, timestamp_t &last_modified_time,
                     bool has_last_modified_time, FileType file_type,
-                    bool on_disk_file, size_t sz, unique_ptr<data_t[]> data)
+                    bool on_disk_file, struct archive *archive,
+                    struct archive_entry *entry,
+                    unique_ptr<LibArchiveHandle> archive_handle,
+                    shared_ptr<EntryCache> entry_cache, string cache_key,
+                    idx_t cache_size, BufferManager &buffer_manager,
+                    SpillOptions spill)
       : FileHandle(file_system, path, flags),
         last_modified_time(last_modified_time),
         has_last_modified_time(has_last_modified_time), file_type(file_type),
-        on_disk_file(on_disk_file), sz(sz), data(std::move(data)),
+        on_disk_file(on_disk_file), archive(archive), entry(entry),
+        archive_handle(std::move(archive_handle)),
+        entry_cache(std::move(entry_cache)), cache_key(std::move(cache_key)),
+        cache_size(cache_size), buffer_manager(buffer_manager),
+        spill(std::move(spill)), loaded(false),
+        size_known(archive_entry_size_is_set(entry)),
+        sz(size_known ? archive_entry_size(entry) : 0), seek_offset(0) {}
+  // Serve an entry found in the entry cache
+  ArchiveFileHandle(FileSystem &file_system, const string &path,
+                    FileOpenFlags flags, timestamp_t &last_modified_time,
+                    bool has_last_modified_time, FileType file_type,
+                    bool on_disk_file, shared_ptr<DecompressedEntry> data,
+                    BufferHandle pin)
+      : FileHandle(file_system, path, flags),
+        last_modified_time(last_modified_time),
+        has_last_modified_time(has_last_modified_time), file_type(file_type),
+        on_disk_file(on_disk_file), archive(nullptr), entry(nullptr),
+        cache_size(0), buffer_manager(data->GetBufferManager()), loaded(true),
+        size_known(true), sz(data->size), data(std::move(data)),
+        pin(std::move(pin)), seek_offset(0) {}
+  // Read a compressed file made of blocks at known positions a block at a
+  // time, without loading it
+  ArchiveFileHandle(FileSystem &file_system, const string &path,
+                    FileOpenFlags flags, timestamp_t &last_modified_time,
+                    bool has_last_modified_time, FileType file_type,
+                    bool on_disk_file, BufferManager &buffer_manager,
+                    unique_ptr<SeekableCompressedFile> seekable)
+      : FileHandle(file_system, path, flags),
+        last_modified_time(last_modified_time),
+        has_last_modified_time(has_last_modified_time), file_type(file_type),
+        on_disk_file(on_disk_file), archive(nullptr), entry(nullptr),
+        cache_size(0), buffer_manager(buffer_manager), loaded(true),
+        size_known(false), sz(0), seekable(std::move(seekable)),
         seek_offset(0) {}
+  ~ArchiveFileHandle() override;
 
   void Close() override;
 
+  idx_t GetSize();
+  idx_t ReadAt(void *buffer, idx_t nr_bytes, idx_t location);
+
 private:
+  // Decompress the entry. Opening only reads the entry's header, so handles
+  // opened just to get a file's modification time, or its size when the
+  // header records it, never decompress anything.
+  void Load();
+  // Inflate a large gzip file on several threads instead of with libarchive.
+  // Returns false if it is not a gzip file that can be split between threads.
+  bool InflateGzipInParallel();
+  // Decompress a compressed:// file made of several gzip members, bzip2
+  // blocks or zstd frames on several threads instead of with libarchive.
+  // Returns false if it is not made of parts, having read nothing.
+  bool DecompressPartsInParallel();
+  // Take the decompressed file from the entry cache, where another handle
+  // may have put it since this one was opened. Returns false if it is not
+  // there.
+  bool LoadFromCache();
+  void FreeArchive();
+
+  // Read from the stream of output of a compressed:// file, decompressing
+  // as far as needed. Returns false once the handle is not streamed, or
+  // when location is before the output still held, in which case the stream
+  // is given up for decompressing the whole file as usual.
+  bool ReadStream(void *buffer, idx_t nr_bytes, idx_t location,
+                  idx_t &read_bytes);
+  // Set the size of a streamed file, decompressing all of it to count it
+  // unless its header records it or it was counted before. The count is
+  // remembered in the entry cache. Returns false unless the file is
+  // streamed.
+  bool SizeStream();
+  // Decompress the next piece of a streamed file into its buffer. Returns
+  // false at the end of the file.
+  bool AdvanceStream();
+  // Start reading a compressed:// file from its beginning again
+  void RestartArchive();
+
   timestamp_t last_modified_time;
   bool has_last_modified_time;
   FileType file_type;
   bool on_disk_file;
 
+  // Held until the entry is loaded
+  struct archive *archive;
+  struct archive_entry *entry;
+  unique_ptr<LibArchiveHandle> archive_handle;
+
+  shared_ptr<EntryCache> entry_cache;
+  // Key of the entry in the entry cache, empty when caching is disabled
+  string cache_key;
+  idx_t cache_size;
+  BufferManager &buffer_manager;
+  SpillOptions spill;
+  // Threads inflating a compressed:// gzip file, 1 unless
+  // zipfs_parallel_inflate is set
+  idx_t inflate_threads = 1;
+  // Threads decompressing the parts of a compressed:// file, 1 unless
+  // zipfs_parallel_members is set
+  idx_t part_threads = 1;
+  // Size of the buffer of recent output of a compressed:// file read as a
+  // stream, 0 unless zipfs_stream_buffer_size is set, and once the stream was
+  // given up
+  idx_t stream_buffer_size = 0;
+  // The last stream_buffer_size bytes of output before stream_pos, each at
+  // its position modulo the size. Allocated when first read.
+  PooledBuffer stream_buffer;
+  idx_t stream_pos = 0;
+
+  mutex load_lock;
+  atomic<bool> loaded;
+  // Whether the entry's header records its size, otherwise sz is only set
+  // once loaded
+  bool size_known;
   size_t sz;
-  unique_ptr<data_t[]> data;
+  shared_ptr<DecompressedEntry> data;
+  // Keeps data in memory while the handle is open
+  BufferHandle pin;
+  // Set instead of data when the entry was decompressed to disk
+  unique_ptr<SpillFile> spill_file;
+  // Set instead of data when the file is read a block at a time
+  unique_ptr<SeekableCompressedFile> seekable;
   idx_t seek_offset;
 };
 
 class ArchiveFileSystem final : public FileSystem {
 public:
-  explicit ArchiveFileSystem() : FileSystem() {}
+  explicit ArchiveFileSystem(shared_ptr<EntryCache> entry_cache)
+      : FileSystem(), entry_cache(std::move(entry_cache)) {}
 
   timestamp_t GetLastModifiedTime(FileHandle &handle) override;
   FileType GetFileType(FileHandle &handle) override;
@@ -92,13 +265,20 @@ public:
 
   unique_ptr<FileHandle> OpenFile(const string &path, FileOpenFlags flags,
                                   optional_ptr<FileOpener> opener) override;
+  // Opens files with the info from Glob
+  unique_ptr<FileHandle>
+  OpenFileExtended(const OpenFileInfo &file, FileOpenFlags flags,
+                   optional_ptr<FileOpener> opener) override;
+  bool SupportsOpenFileExtended() const override { return true; }
 
 private:
+  shared_ptr<EntryCache> entry_cache;
 };
 
 class RawArchiveFileSystem final : public FileSystem {
 public:
-  explicit RawArchiveFileSystem() : FileSystem() {}
+  explicit RawArchiveFileSystem(shared_ptr<EntryCache> entry_cache)
+      : FileSystem(), entry_cache(std::move(entry_cache)) {}
 
   timestamp_t GetLastModifiedTime(FileHandle &handle) override;
   FileType GetFileType(FileHandle &handle) override;
@@ -123,6 +303,7 @@ public:
                                   optional_ptr<FileOpener> opener) override;
 
 private:
+  shared_ptr<EntryCache> entry_cache;
 };
 
 } // namespace duckdb
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "duckdb/common/common.hpp"
+
+namespace duckdb {
+
+// A glob pattern for paths within an archive, compiled once per glob and then
+// matched against every entry name without splitting or allocating. Paths
+// are made of components separated by '/'. "**" matches any number of
+// components, including none, and may appear anywhere in the pattern. Other
+// components are matched with DuckDB's Glob, so "*" never crosses a '/'.
+class ArchiveGlob final {
+public:
+  explicit ArchiveGlob(const string &pattern);
+
+  bool Match(const char *name, idx_t len) const;
+  bool Match(const string &name) const {
+    return Match(name.c_str(), name.size());
+  }
+
+  // The leading components of the pattern which hold no wildcards, ending
+  // with '/'. Every matching name starts with it, so names which do not can
+  // be skipped without matching them.
+  const string &GetLiteralPrefix() const { return literal_prefix; }
+
+private:
+  struct Component {
+    string pattern;
+    // "**"
+    bool recursive;
+    // No wildcards, compared byte for byte
+    bool literal;
+  };
+
+  // Match components from component_idx on against the name starting at pos,
+  // which is the start of a component or len + 1 once all were matched
+  bool MatchFrom(idx_t component_idx, const char *name, idx_t len,
+                 idx_t pos) const;
+
+  vector<Component> components;
+  string literal_prefix;
+};
+
+} // namespace duckdb
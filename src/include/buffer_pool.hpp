@@ -0,0 +1,70 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+
+namespace duckdb {
+
+// Smallest and largest buffers kept for reuse, larger ones are freed at once
+const idx_t BUFFER_POOL_MIN_SIZE = 64 * 1024;
+const idx_t BUFFER_POOL_MAX_SIZE = 64 * 1024 * 1024;
+
+// Default for zipfs_buffer_pool_size, the most memory held by buffers
+// waiting to be reused
+const idx_t DEFAULT_BUFFER_POOL_SIZE = 128 * 1024 * 1024;
+
+class BufferPool;
+
+// A buffer from the pool, returned to it when destroyed. Its contents are not
+// initialized.
+class PooledBuffer final {
+public:
+  PooledBuffer() : ptr(nullptr), capacity(0) {}
+  PooledBuffer(data_t *ptr, idx_t capacity) : ptr(ptr), capacity(capacity) {}
+  PooledBuffer(PooledBuffer &&other) noexcept;
+  PooledBuffer &operator=(PooledBuffer &&other) noexcept;
+  ~PooledBuffer();
+
+  data_t *get() const { return ptr; }
+  explicit operator bool() const { return ptr != nullptr; }
+  void reset();
+
+private:
+  data_t *ptr;
+  idx_t capacity;
+};
+
+// Recycles the temporary buffers holding compressed data (whole entries,
+// coalesced reads and streaming input) across the many short-lived handles a
+// glob query opens, rather than going back to the allocator, and the kernel
+// for fresh pages, for each one. Buffers are rounded up to a power of two
+// size class. On Linux, buffers of 2 MiB or more are aligned for and advised
+// to use transparent huge pages.
+class BufferPool final {
+public:
+  static BufferPool &Get();
+
+  PooledBuffer Allocate(idx_t size);
+  void Release(data_t *ptr, idx_t capacity);
+
+  // Set the most memory held by idle buffers, freeing any over it
+  void SetMaxIdleSize(idx_t size);
+  // Free all idle buffers
+  void Clear();
+
+private:
+  BufferPool();
+
+  static data_t *AllocateMemory(idx_t capacity);
+  static void FreeMemory(data_t *ptr);
+
+  mutex lock;
+  // Idle buffers per size class, starting at BUFFER_POOL_MIN_SIZE
+  vector<vector<data_t *>> free_buffers;
+  idx_t idle_size;
+  idx_t max_idle_size;
+
+  // Free idle buffers, largest first, until at most size bytes are idle
+  void TrimTo(idx_t size);
+};
+
+} // namespace duckdb
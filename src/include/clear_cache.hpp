@@ -0,0 +1,30 @@
+#pragma once
+
+#include "utils.hpp"
+#include "zip_directory_cache.hpp"
+#include "entry_cache.hpp"
+
+namespace duckdb {
+
+struct ClearCacheFunctionInfo : public TableFunctionInfo {
+  ClearCacheFunctionInfo(shared_ptr<ZipDirectoryCache> directory_cache,
+                         shared_ptr<EntryCache> entry_cache)
+      : directory_cache(std::move(directory_cache)),
+        entry_cache(std::move(entry_cache)) {}
+
+  shared_ptr<ZipDirectoryCache> directory_cache;
+  shared_ptr<EntryCache> entry_cache;
+};
+
+void ClearCacheFunction(ClientContext &context, TableFunctionInput &data,
+                        DataChunk &output);
+
+unique_ptr<FunctionData>
+ClearCacheFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                       vector<LogicalType> &return_types,
+                       vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState>
+ClearCacheFunctionInit(ClientContext &context, TableFunctionInitInput &input);
+
+} // namespace duckdb
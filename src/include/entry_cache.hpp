@@ -0,0 +1,109 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+#include <list>
+
+namespace duckdb {
+
+// Default memory budget for cached decompressed files
+const idx_t DEFAULT_ENTRY_CACHE_SIZE = 256 * 1024 * 1024;
+// Most sizes of streamed files remembered, all of which are dropped when more
+// are added
+const idx_t MAX_CACHED_SIZES = 4096;
+// Most memory taken by remembered block indexes, all of which are dropped
+// when more are added
+const idx_t MAX_CACHED_INDEX_SIZE = 64 * 1024 * 1024;
+
+// A whole decompressed file, shared by the handles reading it and the cache.
+// The data is held in a buffer allocated through DuckDB's buffer manager, so
+// it counts towards memory_limit and shows in duckdb_memory(). While not
+// pinned, the buffer can be evicted under memory pressure, in which case the
+// file has to be decompressed again.
+class DecompressedEntry final {
+public:
+  DecompressedEntry(BufferManager &buffer_manager, idx_t size,
+                    BufferHandle &pin);
+
+  // Allocate a buffer of size bytes, pinned by pin while it is filled
+  static shared_ptr<DecompressedEntry> Allocate(BufferManager &buffer_manager,
+                                                idx_t size, BufferHandle &pin);
+
+  // Pin the buffer to read from it. The result is invalid if the buffer was
+  // evicted.
+  BufferHandle Pin();
+
+  BufferManager &GetBufferManager() { return buffer_manager; }
+
+  // Grow or shrink the buffer, which has to be pinned, keeping its contents
+  void Resize(idx_t new_size);
+
+  idx_t size;
+
+private:
+  BufferManager &buffer_manager;
+  shared_ptr<BlockHandle> block;
+};
+
+// Where the blocks of a seekable compressed file start in the compressed and
+// decompressed file, ending with the end of both
+struct BlockIndex {
+  vector<idx_t> comp_offsets;
+  vector<idx_t> offsets;
+
+  idx_t MemoryUsage() const {
+    return (comp_offsets.size() + offsets.size()) * sizeof(idx_t);
+  }
+};
+
+// Decompressed files within archives, shared by zip://, archive:// and
+// compressed:// across all queries in a database instance. Keys identify the
+// archive by path, size and last modified time or version tag (see
+// GetArchiveKey), plus the file within it, so a changed archive is never
+// served from the cache.
+class EntryCache final {
+public:
+  shared_ptr<DecompressedEntry> Get(const string &key);
+
+  // Cache an entry, replacing any previous entry for the key (which may have
+  // been evicted by the buffer manager). Least recently used entries are
+  // evicted to stay within memory_limit bytes, where 0 disables caching.
+  void Put(const string &key, shared_ptr<DecompressedEntry> entry,
+           idx_t memory_limit);
+
+  // The size of a file read as a stream, which is only known once all of it
+  // was decompressed, as counted before. Returns false if it was not.
+  bool GetSize(const string &key, idx_t &size);
+  void PutSize(const string &key, idx_t size);
+
+  // The whole block index of a seekable compressed file, as built before.
+  // Returns nullptr if it was not.
+  shared_ptr<const BlockIndex> GetIndex(const string &key);
+  void PutIndex(const string &key, shared_ptr<const BlockIndex> index);
+
+  // Drop all entries, sizes and indexes
+  void Clear();
+
+private:
+  struct CachedEntry {
+    string key;
+    shared_ptr<DecompressedEntry> entry;
+  };
+
+  void EvictToLimit(idx_t memory_limit);
+
+  mutex lock;
+  // Most recently used first
+  std::list<CachedEntry> entries;
+  unordered_map<string, std::list<CachedEntry>::iterator> lookup;
+  idx_t memory_usage = 0;
+  unordered_map<string, idx_t> sizes;
+  unordered_map<string, shared_ptr<const BlockIndex>> indexes;
+  idx_t index_memory_usage = 0;
+};
+
+// Identify an archive by its path, size and last modified time or version tag
+// (e.g. ETag)
+string GetArchiveKey(FileHandle &handle);
+
+} // namespace duckdb
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "duckdb/common/common.hpp"
+
+namespace duckdb {
+
+class BufferManager;
+
+// Smallest piece of a deflate stream inflated by one thread
+const idx_t PARALLEL_INFLATE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Whether a deflate stream of comp_size bytes is worth splitting between
+// thread_count threads
+inline bool CanInflateInParallel(idx_t comp_size, idx_t thread_count) {
+  return thread_count > 1 && comp_size >= 2 * PARALLEL_INFLATE_CHUNK_SIZE;
+}
+
+// Inflate a raw deflate stream held in memory into out, which holds out_size
+// bytes, on up to thread_count threads. The stream is split into chunks of
+// compressed data, and each thread guesses where the first block starting in
+// its chunk is by trial decoding. Chunks are inflated from there without the
+// 32 KiB of output before them, which back-references into are recorded and
+// resolved once the output before each chunk is known. A guess only counts
+// once the previous chunk, inflating on, ends exactly where it was made.
+// Output from all but the first chunk is held at two bytes per byte until
+// resolved, in buffers from buffer_manager. Threads are started by ParallelFor,
+// so there can be fewer than thread_count.
+//
+// Returns false unless the data is valid and fills exactly out_size bytes.
+// It also returns false when no guess holds up, e.g. for streams made of
+// stored or fixed Huffman blocks, or when the buffer manager is out of
+// memory, so the stream should be inflated as usual then, which also reports
+// errors.
+bool ParallelInflate(BufferManager &buffer_manager, const data_t *comp_data,
+                     idx_t comp_size, data_t *out, idx_t out_size,
+                     idx_t thread_count,
+                     idx_t chunk_size = PARALLEL_INFLATE_CHUNK_SIZE);
+
+// The deflate stream and trailer of a gzip file
+struct GzipMember {
+  idx_t data_offset;
+  idx_t data_size;
+  uint32_t crc32;
+  // Modulo 2^32, as stored in the trailer
+  uint32_t uncomp_size;
+};
+
+// Bytes read to parse a gzip header before deciding whether to read the rest
+const idx_t GZIP_PROBE_SIZE = 4096;
+
+// Parse the header of a gzip member at the start of data. Returns false if
+// data does not start with one. header_size is more than size when the
+// header is cut off.
+bool ParseGzipHeader(const data_t *data, idx_t size, idx_t &header_size);
+
+// Parse the header and trailer of a gzip file holding a whole file of size
+// bytes, assuming it is a single member. Returns false if it is not a gzip
+// file. When there are several members, inflating the first one does not
+// use up data_size bytes, which ParallelInflate reports as invalid.
+bool ParseGzipMember(const data_t *data, idx_t size, GzipMember &member);
+
+} // namespace duckdb
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+#include "zip_decompressor.hpp"
+
+namespace duckdb {
+
+// Compressed data read at a time per thread when decompressing a file in
+// parts
+const idx_t PART_BATCH_SIZE = 8 * 1024 * 1024;
+// Most compressed data read at a time, however many threads there are, and
+// however large a part is
+const idx_t PART_MAX_BATCH_SIZE = 128 * 1024 * 1024;
+// Most output of a part, which is held in memory until passed on
+const idx_t PART_MAX_OUTPUT_SIZE = 256 * 1024 * 1024;
+// Most output of all parts of a batch, apart from the first
+const idx_t PART_MAX_BATCH_OUTPUT_SIZE = 512 * 1024 * 1024;
+
+// Decompresses a compressed:// file made of parts which decompress
+// independently on several threads: the members of a multi-member gzip file
+// (e.g. from bgzip or concatenated gzip files), the blocks of a bzip2 file, or
+// the frames of a multi-frame zstd file (e.g. from pzstd). The file is read in
+// batches of compressed data, whose parts are decompressed in parallel, then
+// passed on in order.
+//
+// Where gzip members and bzip2 blocks start is not recorded, so their headers
+// are searched for. Matches within compressed data are decompressed too, but
+// parts are only used when chained from the start of the file, each starting
+// where the one before ended.
+//
+// Output is allocated from the buffer manager. Parts after the first of a
+// batch stop once the batch holds PART_MAX_BATCH_OUTPUT_SIZE bytes of output,
+// and are decompressed again in a later batch. Parts with more than
+// max_part_size bytes of output (at most PART_MAX_OUTPUT_SIZE), or more
+// compressed data than PART_MAX_BATCH_SIZE, or whose output does not fit in
+// memory, are not decompressed this way, and the file is left to be read as a
+// single stream.
+class ParallelPartReader final {
+public:
+  ParallelPartReader(BufferManager &buffer_manager, FileHandle &handle,
+                     idx_t thread_count, idx_t max_part_size);
+
+  // Read and decompress the first batch of the file. Returns false unless the
+  // file is in a known format and made of several parts in the first batch,
+  // in which case it is better read as a single stream, and nothing is
+  // passed on by Read. The format is checked from the start of the file
+  // before a whole batch is read.
+  bool Start();
+
+  // Decompress the rest of the file after Start, passing the output to output
+  // in order. Throws an IOException if the data is invalid. Returns false if
+  // a part turns out too large, after passing on the output before it, in
+  // which case the file has to be read as a single stream from the start.
+  bool Read(const ZipOutputFunction &output);
+
+  struct Part {
+    // Bit positions within the batch
+    idx_t start = 0;
+    idx_t end = 0;
+    // Whether the part ends within the batch, otherwise it is decompressed
+    // again from the next batch
+    bool complete = false;
+    // Whether the data is valid, as far as it goes
+    bool valid = false;
+    // Whether the output is larger than max_part_size, or out of memory
+    bool too_large = false;
+    // Whether the part is exempt from the batch's output limit
+    bool first = false;
+    // Whether the part stopped at the batch's output limit
+    bool deferred = false;
+    // The first output_size bytes are the output, in a buffer of
+    // output_capacity bytes
+    BufferHandle output;
+    idx_t output_size = 0;
+    idx_t output_capacity = 0;
+  };
+
+  // Allocates the output of the parts of a batch from the buffer manager
+  class OutputAllocator {
+  public:
+    OutputAllocator(BufferManager &buffer_manager, idx_t max_part_size)
+        : buffer_manager(buffer_manager), max_part_size(max_part_size),
+          batch_output(0) {}
+
+    // Grow the output of part to size bytes. Returns false, marking the part
+    // too large or deferred, if it cannot.
+    bool Grow(Part &part, idx_t size);
+    // Start on the parts of the next batch, once those of the last are
+    // passed on
+    void Reset() { batch_output = 0; }
+
+    BufferManager &buffer_manager;
+    idx_t max_part_size;
+    // Output allocated for the parts of the batch
+    atomic<idx_t> batch_output;
+  };
+
+private:
+  enum class Format : uint8_t { GZIP, BZIP2, ZSTD };
+
+  // Drop the data before position from the batch, then read up to batch_size
+  // bytes into it
+  void FillBatch();
+  // Decompress the parts in the batch, adding those chained from position to
+  // parts and moving position past them. Returns false if the data is
+  // invalid.
+  bool DecodeBatch();
+  bool DecodeGzipBatch();
+  bool DecodeBzip2Batch();
+  bool DecodeZstdBatch();
+
+  // The end of the file, with nothing more to read
+  bool AtEnd() const { return batch_offset + batch.size() == file_size; }
+
+  FileHandle &handle;
+  idx_t thread_count;
+  idx_t max_part_size;
+  OutputAllocator allocator;
+  idx_t file_size;
+  Format format;
+  idx_t batch_size;
+  // Compressed data from batch_offset in the file on
+  vector<data_t> batch;
+  idx_t batch_offset;
+  // Bit position in the batch where the next part starts
+  idx_t position;
+  // Set once the last part was decompressed
+  bool done;
+  // Set once a part was found to be too large
+  bool too_large;
+  // Parts decompressed but not passed on yet
+  vector<Part> parts;
+};
+
+} // namespace duckdb
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "entry_cache.hpp"
+
+namespace duckdb {
+
+// Decompressed blocks kept by each file for reads which do not cover them
+// whole
+const idx_t SEEKABLE_BLOCK_CACHE_COUNT = 8;
+
+// Compressed data read at a time when building the block index of a BGZF
+// file, and checked for BGZF blocks when it is opened
+const idx_t BGZF_SCAN_SIZE = 4 * 1024 * 1024;
+
+// A compressed:// file made of blocks which decompress independently and
+// whose positions are known, so any range of it is read by decompressing only
+// the blocks holding it:
+//
+// - BGZF (blocked gzip, as written by bgzip), whose gzip members record their
+//   own compressed size. The index of the blocks is loaded from a .gzi file
+//   next to the file, if any, and otherwise built by reading block headers as
+//   reads get to them, BGZF_SCAN_SIZE bytes at a time. Whole indexes are kept
+//   in the EntryCache for other handles of the same file.
+// - zstd's seekable format, whose frames are listed in a seek table at the end
+//   of the file.
+//
+// Reads may come from several threads at once.
+class SeekableCompressedFile final {
+public:
+  // Recognize a BGZF or seekable zstd file from its first and last bytes,
+  // taking the handle if so. Returns nullptr otherwise, including for gzip
+  // files whose first BGZF_SCAN_SIZE bytes hold other gzip members than BGZF
+  // blocks, such as a small BGZF file with a plain gzip file appended.
+  static unique_ptr<SeekableCompressedFile>
+  TryOpen(FileSystem &fs, const string &path, unique_ptr<FileHandle> &handle,
+          const string &inflate_backend, shared_ptr<EntryCache> index_cache);
+
+  // Every block header of a BGZF file is read to tell its size
+  idx_t GetSize();
+  // Throws an IOException at anything but a BGZF block in a BGZF file
+  idx_t ReadAt(void *buffer, idx_t nr_bytes, idx_t location);
+
+private:
+  enum class Format : uint8_t { BGZF, ZSTD };
+
+  struct Block {
+    idx_t index;
+    idx_t comp_offset;
+    idx_t comp_size;
+    idx_t offset;
+    idx_t size;
+  };
+
+  SeekableCompressedFile(FileSystem &fs, string path,
+                         unique_ptr<FileHandle> handle, Format format,
+                         string inflate_backend,
+                         shared_ptr<EntryCache> index_cache);
+
+  // Load the index of a BGZF file and check the blocks in the first scan.
+  // Returns false at anything but a BGZF block.
+  bool LoadIndex();
+  // Read the .gzi index next to a BGZF file. Returns false if there is none,
+  // or it does not fit the file.
+  bool ReadGziIndex();
+  // Add blocks from the end of the index on by reading their headers, a scan
+  // at a time, until the index goes past target in the decompressed file or
+  // gets to the end of the file. Returns false at anything but a whole BGZF
+  // block.
+  bool ScanBgzfBlocks(idx_t target);
+  // Read the seek table of a seekable zstd file into the index. Returns false
+  // if there is none.
+  bool ReadSeekTable();
+
+  // The block holding location, scanning for it if needed. Returns false past
+  // the end of the file.
+  bool FindBlock(idx_t location, Block &block);
+  // Decompress a block into out, which holds its whole output
+  void DecompressBlock(const Block &block, data_t *out);
+  // A decompressed block, from the cache if it is there
+  shared_ptr<vector<data_t>> GetBlock(const Block &block);
+
+  FileSystem &fs;
+  string path;
+  unique_ptr<FileHandle> handle;
+  Format format;
+  string inflate_backend;
+  shared_ptr<EntryCache> index_cache;
+  string index_key;
+
+  // Where each block starts, up to where the index was built so far. Until it
+  // is complete, it is only used holding index_lock, and building is the same
+  // index while it grows.
+  shared_ptr<const BlockIndex> index;
+  shared_ptr<BlockIndex> building;
+  mutex index_lock;
+  atomic<bool> complete;
+
+  mutex cache_lock;
+  // Recently decompressed blocks, replaced in turn
+  vector<pair<idx_t, shared_ptr<vector<data_t>>>> cache;
+  idx_t next_cache_slot;
+};
+
+} // namespace duckdb
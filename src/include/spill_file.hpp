@@ -0,0 +1,57 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/common/limits.hpp"
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+// Default size above which decompressed files are written to disk
+const idx_t DEFAULT_SPILL_THRESHOLD = 1024 * 1024 * 1024;
+
+// Size of the pieces decompressed files are written to disk in
+const idx_t SPILL_CHUNK_SIZE = 1024 * 1024;
+
+// Where decompressed files are spilled to, captured when a file is opened
+struct SpillOptions {
+  optional_ptr<FileSystem> fs;
+  string directory;
+  // 0 disables spilling
+  idx_t threshold = 0;
+
+  // Largest decompressed file kept in memory
+  idx_t MaxInMemorySize() const {
+    if (!fs || directory.empty() || threshold == 0) {
+      return NumericLimits<idx_t>::Maximum();
+    }
+    return threshold;
+  }
+
+  // Whether a decompressed file of size bytes should go to disk
+  bool ShouldSpill(idx_t size) const { return size > MaxInMemorySize(); }
+};
+
+// Read zipfs_spill_threshold and DuckDB's temp_directory
+SpillOptions GetSpillOptions(ClientContext &context);
+
+// A decompressed file written to DuckDB's temp directory rather than held in
+// memory. The file is written once, front to back, then read at any position
+// by the handle that created it, and removed when destroyed.
+class SpillFile final {
+public:
+  explicit SpillFile(const SpillOptions &options);
+  ~SpillFile();
+
+  void Append(const data_t *buffer, idx_t nr_bytes);
+  idx_t ReadAt(void *buffer, idx_t nr_bytes, idx_t location);
+
+  idx_t GetSize() const { return size; }
+
+private:
+  FileSystem &fs;
+  string path;
+  unique_ptr<FileHandle> handle;
+  idx_t size;
+};
+
+} // namespace duckdb
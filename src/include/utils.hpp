@@ -2,17 +2,208 @@
 
 #include "duckdb/common/file_system.hpp"
 #include "duckdb/common/virtual_file_system.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/main/client_context.hpp"
+#include "duckdb/parallel/task_scheduler.hpp"
+#include <functional>
+#ifndef DUCKDB_NO_THREADS
+#include <thread>
+#endif
 
 namespace duckdb {
 
 // TODO: Something is incorrect about the type in make_uniq_array<...,
 // std::default_delete<DATA_TYPE>, ...>
+// The array is not value-initialized, so buffers of data_t are not zeroed;
+// every caller fills them before reading.
 template <class DATA_TYPE>
 inline unique_ptr<DATA_TYPE[], std::default_delete<DATA_TYPE[]>, true>
 make_uniq_array2(size_t n) // NOLINT: mimic std style
 {
   return unique_ptr<DATA_TYPE[], std::default_delete<DATA_TYPE[]>, true>(
-      new DATA_TYPE[n]());
+      new DATA_TYPE[n]);
+}
+
+// Read a UBIGINT setting, such as a size in bytes
+inline idx_t GetSizeSetting(ClientContext &context, const string &name,
+                            idx_t default_value) {
+  Value setting_value = Value::UBIGINT(default_value);
+  context.TryGetCurrentSetting(name, setting_value);
+  return setting_value.GetValue<uint64_t>();
+}
+
+// Read a VARCHAR setting
+inline string GetStringSetting(ClientContext &context, const string &name,
+                               const string &default_value) {
+  Value setting_value = default_value;
+  context.TryGetCurrentSetting(name, setting_value);
+  return setting_value.GetValue<string>();
+}
+
+// Read a BOOLEAN setting
+inline bool GetBoolSetting(ClientContext &context, const string &name,
+                           bool default_value) {
+  Value setting_value = Value::BOOLEAN(default_value);
+  context.TryGetCurrentSetting(name, setting_value);
+  return setting_value.GetValue<bool>();
+}
+
+// Prefix of the extended info options of a file within an archive which
+// describe the archive itself
+auto const ARCHIVE_INFO_PREFIX = "zipfs_archive_";
+
+// Describe an open archive for the files globbed within it: its size, last
+// modified time and ETag, on top of whatever the archive's own glob (e.g. an
+// S3 listing) reported
+inline unordered_map<string, Value> GetArchiveInfo(const OpenFileInfo &archive,
+                                                   FileHandle &handle) {
+  unordered_map<string, Value> info;
+  if (archive.extended_info) {
+    info = archive.extended_info->options;
+  }
+  auto &fs = handle.file_system;
+  info["file_size"] = Value::UBIGINT(handle.GetFileSize());
+  try {
+    info["last_modified"] = Value::TIMESTAMP(fs.GetLastModifiedTime(handle));
+  } catch (NotImplementedException &ex) {
+    // Not known without it
+  }
+  auto version_tag = fs.GetVersionTag(handle);
+  if (!version_tag.empty()) {
+    info["etag"] = Value(version_tag);
+  }
+  return info;
+}
+
+// Describe a file within an archive to DuckDB's multi-file readers, which
+// use file_size and last_modified instead of opening the file to get them.
+// The archive's info is carried along so that opening the file can open the
+// archive without fetching its metadata again.
+inline OpenFileInfo
+MakeArchiveEntryInfo(const string &path,
+                     const unordered_map<string, Value> &archive_info,
+                     const Value &file_size) {
+  OpenFileInfo result(path);
+  result.extended_info = make_shared_ptr<ExtendedOpenFileInfo>();
+  auto &options = result.extended_info->options;
+  for (auto &option : archive_info) {
+    options[ARCHIVE_INFO_PREFIX + option.first] = option.second;
+  }
+  if (!file_size.IsNull()) {
+    options["file_size"] = file_size;
+  }
+  // Files within an archive report the archive's last modified time
+  auto last_modified = archive_info.find("last_modified");
+  if (last_modified != archive_info.end()) {
+    options["last_modified"] = last_modified->second;
+  }
+  return result;
+}
+
+// The archive holding a file opened with MakeArchiveEntryInfo's info, to open
+// with the archive's info
+inline OpenFileInfo GetArchiveOpenInfo(const string &archive_path,
+                                       const OpenFileInfo &file) {
+  OpenFileInfo result(archive_path);
+  if (!file.extended_info) {
+    return result;
+  }
+  const string prefix = ARCHIVE_INFO_PREFIX;
+  for (auto &option : file.extended_info->options) {
+    if (StringUtil::StartsWith(option.first, prefix)) {
+      if (!result.extended_info) {
+        result.extended_info = make_shared_ptr<ExtendedOpenFileInfo>();
+      }
+      result.extended_info->options[option.first.substr(prefix.size())] =
+          option.second;
+    }
+  }
+  return result;
+}
+
+#ifndef DUCKDB_NO_THREADS
+// Threads ParallelFor may start on top of the callers', shared by all calls.
+// Callers are often DuckDB's own workers, so without a shared budget each of
+// them could start as many threads as there are cores.
+class HelperThreads {
+public:
+  // Take up to wanted threads from the budget, returned on destruction
+  explicit HelperThreads(idx_t wanted) : count(0) {
+    auto &budget = Budget();
+    auto available = budget.load();
+    do {
+      count = MinValue(wanted, available);
+    } while (count > 0 &&
+             !budget.compare_exchange_weak(available, available - count));
+  }
+  ~HelperThreads() { Budget() += count; }
+
+  idx_t count;
+
+private:
+  static atomic<idx_t> &Budget() {
+    static atomic<idx_t> budget(
+        MaxValue<idx_t>(std::thread::hardware_concurrency(), 2) - 1);
+    return budget;
+  }
+};
+#endif
+
+// Run work(i) for every i in [0, count) on up to max_threads threads,
+// including the calling one, as far as the helper thread budget allows. Once
+// all work is done, the exception thrown for the lowest i, if any, is
+// rethrown, so errors are the same as for a serial loop.
+inline void ParallelFor(idx_t max_threads, idx_t count,
+                        const std::function<void(idx_t)> &work) {
+  idx_t thread_count = 1;
+#ifndef DUCKDB_NO_THREADS
+  auto wanted = MinValue<idx_t>(count, max_threads);
+  HelperThreads helpers(wanted > 1 ? wanted - 1 : 0);
+  thread_count = helpers.count + 1;
+#endif
+  if (thread_count <= 1) {
+    for (idx_t i = 0; i < count; i++) {
+      work(i);
+    }
+    return;
+  }
+
+  vector<std::exception_ptr> errors(count);
+  atomic<idx_t> next(0);
+  auto worker = [&]() {
+    for (auto i = next++; i < count; i = next++) {
+      try {
+        work(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+#ifndef DUCKDB_NO_THREADS
+  vector<std::thread> threads;
+  for (idx_t t = 1; t < thread_count; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+#endif
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Run work(i) for every i in [0, count) on up to as many threads as DuckDB
+// is configured to use
+inline void ParallelFor(ClientContext &context, idx_t count,
+                        const std::function<void(idx_t)> &work) {
+  ParallelFor(NumericCast<idx_t>(
+                  TaskScheduler::GetScheduler(context).NumberOfThreads()),
+              count, work);
 }
 
 } // namespace duckdb
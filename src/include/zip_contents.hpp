@@ -1,11 +1,18 @@
 #pragma once
 
-#include <miniz/miniz.h>
-#include <miniz/miniz_zip.h>
 #include "utils.hpp"
+#include "zip_directory_cache.hpp"
 
 namespace duckdb {
 
+struct ZipContentsFunctionInfo : public TableFunctionInfo {
+  explicit ZipContentsFunctionInfo(
+      shared_ptr<ZipDirectoryCache> directory_cache)
+      : directory_cache(std::move(directory_cache)) {}
+
+  shared_ptr<ZipDirectoryCache> directory_cache;
+};
+
 void ReadZipFunction(ClientContext &context, TableFunctionInput &data,
                      DataChunk &output);
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include <functional>
+
+namespace duckdb {
+
+// Zip compression methods which can be read
+const uint16_t ZIP_METHOD_STORED = 0;
+const uint16_t ZIP_METHOD_DEFLATE = 8;
+const uint16_t ZIP_METHOD_DEFLATE64 = 9;
+const uint16_t ZIP_METHOD_BZIP2 = 12;
+const uint16_t ZIP_METHOD_LZMA = 14;
+const uint16_t ZIP_METHOD_ZSTD = 93;
+
+// Default for zipfs_inflate_backend: the fastest backend built in
+auto const DEFAULT_INFLATE_BACKEND = "auto";
+
+// Supplies compressed data in pieces, returning the number of bytes read into
+// buffer, which is only less than nr_bytes at the end of the data
+typedef std::function<idx_t(data_t *buffer, idx_t nr_bytes)> ZipInputFunction;
+
+// Receives decompressed data in pieces
+typedef std::function<void(const data_t *buffer, idx_t nr_bytes)>
+    ZipOutputFunction;
+
+// Decompresses whole zip entries held in memory. Implementations are not
+// thread safe, each open file uses its own.
+class ZipDecompressor {
+public:
+  virtual ~ZipDecompressor() = default;
+
+  // Decompress comp_size bytes of an entry's data into out. Returns false
+  // unless the data is valid and fills exactly out_size bytes.
+  virtual bool Decompress(const data_t *comp_data, idx_t comp_size,
+                          data_t *out, idx_t out_size) = 0;
+
+  // Decompress an entry without holding its data in memory, reading it from
+  // input and passing the output to output in pieces. Returns false unless the
+  // data is valid and produces exactly out_size bytes. Only implemented for
+  // methods where CanStream is true.
+  virtual bool DecompressStreaming(const ZipInputFunction &input,
+                                   idx_t out_size,
+                                   const ZipOutputFunction &output);
+
+  // Whether the compression method is known, though it may not be built in
+  static bool IsKnownMethod(uint16_t method);
+
+  // Whether DecompressStreaming is implemented for a compressed method.
+  // Deflate is streamed by ZipEntryStream instead.
+  static bool CanStream(uint16_t method);
+
+  // Throw an InvalidInputException unless backend is a valid
+  // zipfs_inflate_backend
+  static void CheckInflateBackend(const string &backend);
+
+  // Create the decompressor for a compressed (not stored) method. Deflate
+  // uses the zipfs_inflate_backend given: "miniz", "libdeflate" if built with
+  // it, or "auto" for the fastest available.
+  static unique_ptr<ZipDecompressor> Create(uint16_t method,
+                                            const string &backend);
+};
+
+// Compute the CRC-32 of data, as stored in zip headers, continuing from the
+// CRC-32 of any preceding data
+uint32_t ZipCrc32(const data_t *data, idx_t size, uint32_t crc = 0);
+
+} // namespace duckdb
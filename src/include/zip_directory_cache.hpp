@@ -0,0 +1,179 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "entry_cache.hpp"
+#include <list>
+
+namespace duckdb {
+
+// Default memory budget for cached central directories
+const idx_t DEFAULT_DIRECTORY_CACHE_SIZE = 128 * 1024 * 1024;
+
+// Default number of bytes read from the end of an archive when opening it
+const idx_t DEFAULT_TAIL_READ_SIZE = 256 * 1024;
+
+// Little-endian fields of zip headers
+inline uint16_t LoadLE16(const data_t *ptr) {
+  return static_cast<uint16_t>(ptr[0] | (ptr[1] << 8));
+}
+
+inline uint32_t LoadLE32(const data_t *ptr) {
+  return static_cast<uint32_t>(ptr[0]) | (static_cast<uint32_t>(ptr[1]) << 8) |
+         (static_cast<uint32_t>(ptr[2]) << 16) |
+         (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+inline uint64_t LoadLE64(const data_t *ptr) {
+  return static_cast<uint64_t>(LoadLE32(ptr)) |
+         (static_cast<uint64_t>(LoadLE32(ptr + 4)) << 32);
+}
+
+// Metadata of a single entry in a zip archive's central directory, copied out
+// of the directory for a handle reading the entry
+struct ZipDirectoryEntry {
+  string name;
+  idx_t local_header_ofs;
+  // Upper bound of the end of the entry's local header, data and data
+  // descriptor, which is where the next entry starts
+  idx_t end_ofs;
+  idx_t comp_size;
+  idx_t uncomp_size;
+  uint32_t crc32;
+  uint16_t method;
+  time_t time;
+  bool is_directory;
+  bool is_encrypted;
+};
+
+// The parsed central directory of a zip archive, held column by column: the
+// names of all entries back to back in one buffer, parallel arrays of their
+// offsets, sizes, CRCs and methods, and an open addressing hash table of
+// entry indices for lookups by name. Archives with millions of entries take
+// a few dozen bytes per entry besides the names.
+class ZipDirectory final {
+public:
+  // Read the central directory of the archive in handle, starting with a
+  // single read of the last tail_size bytes of the archive
+  static shared_ptr<ZipDirectory> Read(FileHandle &handle, idx_t tail_size);
+
+  idx_t EntryCount() const { return local_header_offsets.size(); }
+
+  // Name of entry idx, which is not null terminated
+  const char *GetNameData(idx_t idx) const {
+    return names.data() + name_offsets[idx];
+  }
+  idx_t GetNameLength(idx_t idx) const {
+    return name_offsets[idx + 1] - name_offsets[idx];
+  }
+  string GetName(idx_t idx) const {
+    return string(GetNameData(idx), GetNameLength(idx));
+  }
+
+  idx_t GetLocalHeaderOffset(idx_t idx) const {
+    return local_header_offsets[idx];
+  }
+  idx_t GetEndOffset(idx_t idx) const { return end_offsets[idx]; }
+  idx_t GetUncompressedSize(idx_t idx) const { return uncomp_sizes[idx]; }
+  uint16_t GetMethod(idx_t idx) const { return methods[idx]; }
+  bool IsDirectory(idx_t idx) const {
+    return flags[idx] & ZIP_ENTRY_IS_DIRECTORY;
+  }
+  bool IsEncrypted(idx_t idx) const {
+    return flags[idx] & ZIP_ENTRY_IS_ENCRYPTED;
+  }
+
+  // Copy out all metadata of entry idx
+  ZipDirectoryEntry GetEntry(idx_t idx) const;
+
+  // Index of the first entry with the given name, if any, or otherwise of
+  // the first whose name differs only in case
+  optional_idx Find(const string &name) const;
+
+  // Indices of the entries whose name starts with prefix, in central
+  // directory order. Found by binary search, so globs under a fixed directory
+  // skip the rest of the archive.
+  vector<idx_t> FindPrefix(const string &prefix) const;
+
+  // Approximate number of bytes used by the directory
+  idx_t MemoryUsage() const;
+
+  // Write the directory to out for an index file, tagged with archive_key
+  // (see GetArchiveKey) to tell which version of the archive it describes
+  void Serialize(const string &archive_key, string &out) const;
+  // Read a directory written by Serialize. Returns nullptr if data is not a
+  // valid index, describes another version of the archive, or holds entries
+  // which do not fit in archive_size bytes.
+  static shared_ptr<ZipDirectory> Deserialize(const data_t *data, idx_t len,
+                                              const string &archive_key,
+                                              idx_t archive_size);
+
+private:
+  static constexpr uint8_t ZIP_ENTRY_IS_DIRECTORY = 1;
+  static constexpr uint8_t ZIP_ENTRY_IS_ENCRYPTED = 2;
+
+  // Parse count central directory headers from data
+  void ParseEntries(const data_t *data, idx_t len, idx_t count,
+                    idx_t archive_size);
+  // Bound where each entry ends by the start of the entry after it
+  void SetEntryEnds(idx_t archive_size);
+  void BuildIndexes();
+  // Hash table from names to entries, with ASCII case folded if fold_case
+  void BuildHashSlots(vector<uint32_t> &slots, bool fold_case);
+  optional_idx FindSlot(const vector<uint32_t> &slots, const char *name,
+                        idx_t name_len, bool fold_case) const;
+  static hash_t NameHash(const char *name, idx_t name_len, bool fold_case);
+  bool NameEquals(idx_t idx, const char *name, idx_t name_len,
+                  bool fold_case = false) const;
+
+  // Entry i's name is names[name_offsets[i], name_offsets[i + 1])
+  string names;
+  vector<idx_t> name_offsets;
+  vector<idx_t> local_header_offsets;
+  vector<idx_t> end_offsets;
+  vector<idx_t> comp_sizes;
+  vector<idx_t> uncomp_sizes;
+  vector<uint32_t> crc32s;
+  // MS-DOS date in the upper 16 bits, time in the lower 16 bits
+  vector<uint32_t> dos_times;
+  vector<uint16_t> methods;
+  vector<uint8_t> flags;
+
+  // Entry index + 1 by hash of the name, 0 for empty slots. The table has a
+  // power of two size of at least twice the number of entries.
+  vector<uint32_t> hash_slots;
+  // The same, by hash of the name with ASCII case folded
+  vector<uint32_t> folded_hash_slots;
+  // Indices of entries sorted by name
+  vector<uint32_t> sorted_index;
+};
+
+// Central directories of recently used archives, shared by all lookups in a
+// database instance. Archives are identified by GetArchiveKey, so a changed
+// archive is reread.
+class ZipDirectoryCache final {
+public:
+  // Get the directory of the archive in handle, reading and caching it if
+  // needed. Least recently used directories are evicted to stay within
+  // zipfs_directory_cache_size bytes, where 0 disables caching.
+  shared_ptr<ZipDirectory> GetDirectory(ClientContext &context,
+                                        FileHandle &handle);
+
+  void Clear();
+
+private:
+  struct CachedDirectory {
+    string key;
+    shared_ptr<ZipDirectory> directory;
+    idx_t memory_usage;
+  };
+
+  void EvictToLimit(idx_t memory_limit);
+
+  mutex lock;
+  // Most recently used first
+  std::list<CachedDirectory> directories;
+  unordered_map<string, std::list<CachedDirectory>::iterator> lookup;
+  idx_t memory_usage = 0;
+};
+
+} // namespace duckdb
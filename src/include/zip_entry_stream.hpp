@@ -0,0 +1,115 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include <miniz/miniz.h>
+#include <miniz/miniz_zip.h>
+#include "zip_directory_cache.hpp"
+#include "buffer_pool.hpp"
+#include <condition_variable>
+
+namespace duckdb {
+
+// Size of the compressed input buffer kept by a streaming entry
+const idx_t ZIP_STREAM_INPUT_SIZE = 256 * 1024;
+
+// Default distance in uncompressed bytes between inflate checkpoints
+const idx_t DEFAULT_CHECKPOINT_INTERVAL = 4 * 1024 * 1024;
+
+// Most checkpoints kept for an entry, about 43 KiB each
+const idx_t ZIP_MAX_CHECKPOINTS = 128;
+
+// Inflate state at a point in the output. tinfl keeps all of its state in
+// the decompressor struct plus the 32 KiB dictionary, so copying both is
+// enough to resume inflating from here later.
+struct ZipInflateState {
+  tinfl_decompressor decomp;
+  data_t dict[TINFL_LZ_DICT_SIZE];
+  // Position in the dictionary where the next output is written
+  idx_t dict_ofs;
+  // Uncompressed bytes produced before this point
+  idx_t out_pos;
+  // Compressed bytes consumed before this point
+  idx_t comp_pos;
+};
+
+// A position inflation of an entry continues from, with the compressed data
+// around it. Each read of a stream uses one cursor at a time.
+struct ZipStreamCursor {
+  unique_ptr<ZipInflateState> state;
+  // Output of the last step, at state->dict[chunk_ofs, chunk_ofs + chunk_len)
+  // and [chunk_start, chunk_start + chunk_len) in the entry
+  idx_t chunk_start;
+  idx_t chunk_ofs;
+  idx_t chunk_len;
+  bool done;
+  // Only tracked for a pass which started at the beginning of the entry
+  bool crc_valid;
+  uint32_t crc;
+
+  // Compressed data at [input_start, input_start + input_len)
+  PooledBuffer input;
+  idx_t input_start;
+  idx_t input_len;
+};
+
+// Inflates a single deflated zip entry on demand, reading compressed data
+// from the archive as needed. Only the most recent output of each cursor is
+// held in memory. Reads behind a cursor's position resume from the nearest
+// checkpoint, which are recorded every checkpoint_interval bytes of output
+// as inflation advances, or further apart in entries too large for
+// ZIP_MAX_CHECKPOINTS of them.
+//
+// Reads may come from several threads at once, e.g. DuckDB's parallel CSV
+// reader. Each read takes the idle cursor closest behind where it starts, or
+// a new one while there are fewer than max_cursors, so concurrent reads of
+// different parts of the entry inflate in parallel. Checkpoints are shared
+// by all cursors and never change once recorded, so finding one takes no
+// lock.
+class ZipEntryStream final {
+public:
+  ZipEntryStream(FileHandle &inner_handle, const ZipDirectoryEntry &entry,
+                 idx_t data_offset, idx_t checkpoint_interval,
+                 idx_t max_cursors);
+  ~ZipEntryStream();
+
+  idx_t Read(data_t *buffer, idx_t nr_bytes, idx_t location);
+
+private:
+  unique_ptr<ZipStreamCursor> AcquireCursor(idx_t location);
+  void ReleaseCursor(unique_ptr<ZipStreamCursor> cursor);
+  // Give up on a cursor left in an unknown state by an error
+  void DiscardCursor();
+
+  void Restart(ZipStreamCursor &cursor);
+  void SeekTo(ZipStreamCursor &cursor, idx_t location);
+  void Step(ZipStreamCursor &cursor);
+
+  FileHandle &inner_handle;
+  string entry_name;
+  idx_t data_offset;
+  idx_t comp_size;
+  idx_t uncomp_size;
+  uint32_t expected_crc;
+
+  // Find the checkpoint closest before location, if any
+  optional_ptr<ZipInflateState> FindCheckpoint(idx_t location);
+  // Record state as the checkpoint of its interval, unless there is one
+  void AddCheckpoint(const ZipInflateState &state);
+
+  idx_t checkpoint_interval;
+  // checkpoints[i] resumes somewhere in [i, i + 1) * checkpoint_interval,
+  // or is null. They are only set as inflation gets there, as the size
+  // recorded for the entry may not be its actual size. Output past the
+  // recorded size has no checkpoints.
+  idx_t checkpoint_count;
+  unique_array<atomic<ZipInflateState *>> checkpoints;
+
+  mutex cursor_lock;
+  std::condition_variable cursor_available;
+  vector<unique_ptr<ZipStreamCursor>> idle_cursors;
+  // Cursors idle or in use by a read
+  idx_t cursor_count;
+  idx_t max_cursors;
+};
+
+} // namespace duckdb
@@ -2,15 +2,54 @@
 
 #include "duckdb/common/file_system.hpp"
 #include "duckdb/common/virtual_file_system.hpp"
-#include <miniz/miniz.h>
-#include <miniz/miniz_zip.h>
+#include "zip_directory_cache.hpp"
+#include "zip_read_plan.hpp"
+#include "zip_entry_stream.hpp"
+#include "spill_file.hpp"
 
 namespace duckdb {
 
 auto const ZIP_SEPARATOR = "/";
 
-size_t FileSystemZipReadFunc(void *pOpaque, mz_uint64 file_ofs, void *pBuf,
-                             size_t n);
+// Size of the fixed part of a zip local file header
+const idx_t ZIP_LOCAL_HEADER_SIZE = 30;
+
+// Size of the largest data descriptor, zip64 with signature
+const idx_t ZIP_DATA_DESCRIPTOR_SIZE = 24;
+
+// Entries larger than this are inflated on demand rather than at open time
+const idx_t DEFAULT_STREAMING_THRESHOLD = 128 * 1024 * 1024;
+
+// Source of reads when parsing an archive's central directory. The end of the
+// archive, holding the end of central directory record and usually the whole
+// central directory, is fetched with a single read up front.
+struct ZipArchiveReader {
+  ZipArchiveReader(FileHandle &handle, idx_t tail_size);
+
+  // Read from the end fetched up front if it holds the range
+  void Read(data_t *buffer, idx_t nr_bytes, idx_t location);
+
+  FileHandle &handle;
+  unique_ptr<data_t[]> tail;
+  idx_t tail_start;
+  idx_t tail_len;
+};
+
+// Settings captured when an entry is opened, for when it is first read
+struct ZipReadOptions {
+  idx_t streaming_threshold;
+  idx_t checkpoint_interval;
+  // Largest number of reads of a streamed entry which inflate in parallel
+  idx_t stream_cursors;
+  // Threads splitting the inflating of a large entry held in memory, 1 unless
+  // zipfs_parallel_inflate is set
+  idx_t inflate_threads;
+  string inflate_backend;
+  // Key of the entry in the entry cache, empty when caching is disabled
+  string cache_key;
+  idx_t cache_size;
+  SpillOptions spill;
+};
 
 class ZipFileHandle final : public FileHandle {
   friend class ZipFileSystem;
@@ -18,24 +57,59 @@ class ZipFileHandle final : public FileHandle {
 public:
   ZipFileHandle(FileSystem &file_system, const string &path,
                 FileOpenFlags flags, unique_ptr<FileHandle> inner_handle_p,
-                const mz_zip_archive_file_stat &file_stat,
-                unique_ptr<data_t[]> data)
+                shared_ptr<ZipReadPlan> read_plan,
+                const ZipDirectoryEntry &entry, ZipReadOptions options,
+                shared_ptr<EntryCache> entry_cache,
+                BufferManager &buffer_manager)
       : FileHandle(file_system, path, flags),
-        inner_handle(std::move(inner_handle_p)), file_stat(file_stat),
-        data(std::move(data)), seek_offset(0) {}
+        inner_handle(std::move(inner_handle_p)),
+        read_plan(std::move(read_plan)), entry(entry),
+        options(std::move(options)), entry_cache(std::move(entry_cache)),
+        buffer_manager(buffer_manager), loaded(false), data_offset(0),
+        seek_offset(0) {}
 
   void Close() override;
 
+  idx_t ReadAt(void *buffer, idx_t nr_bytes, idx_t location);
+
 private:
+  // Find, decompress or start streaming the entry's data. Opening only looks
+  // the entry up in the central directory, so handles opened just to get a
+  // file's size or modification time never decompress anything.
+  void Load();
+
   unique_ptr<FileHandle> inner_handle;
-  mz_zip_archive_file_stat file_stat;
-  unique_ptr<data_t[]> data;
+  // Reads planned by globs over the archive in the query which opened the
+  // entry, which the entry may be part of. nullptr if there are none.
+  shared_ptr<ZipReadPlan> read_plan;
+  ZipDirectoryEntry entry;
+  ZipReadOptions options;
+  shared_ptr<EntryCache> entry_cache;
+  BufferManager &buffer_manager;
+
+  mutex load_lock;
+  atomic<bool> loaded;
+  shared_ptr<DecompressedEntry> data;
+  // Keeps data in memory while the handle is open. Cached entries which are
+  // not open are unpinned, so DuckDB can evict them under memory pressure.
+  BufferHandle pin;
+  // Set instead of data when the entry is inflated on demand
+  unique_ptr<ZipEntryStream> stream;
+  // Set instead of data when the entry was decompressed to disk
+  unique_ptr<SpillFile> spill_file;
+  // Offset of the entry in the archive. When none of data, stream and
+  // spill_file is set the entry is stored uncompressed and read directly from
+  // inner_handle.
+  idx_t data_offset;
   idx_t seek_offset;
 };
 
 class ZipFileSystem final : public FileSystem {
 public:
-  explicit ZipFileSystem() : FileSystem() {}
+  ZipFileSystem(shared_ptr<ZipDirectoryCache> directory_cache,
+                shared_ptr<EntryCache> entry_cache)
+      : FileSystem(), directory_cache(std::move(directory_cache)),
+        entry_cache(std::move(entry_cache)) {}
 
   timestamp_t GetLastModifiedTime(FileHandle &handle) override;
   FileType GetFileType(FileHandle &handle) override;
@@ -57,8 +131,15 @@ public:
 
   unique_ptr<FileHandle> OpenFile(const string &path, FileOpenFlags flags,
                                   optional_ptr<FileOpener> opener) override;
+  // Opens files with the info from Glob
+  unique_ptr<FileHandle>
+  OpenFileExtended(const OpenFileInfo &file, FileOpenFlags flags,
+                   optional_ptr<FileOpener> opener) override;
+  bool SupportsOpenFileExtended() const override { return true; }
 
 private:
+  shared_ptr<ZipDirectoryCache> directory_cache;
+  shared_ptr<EntryCache> entry_cache;
 };
 
 } // namespace duckdb
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "utils.hpp"
+#include "zip_directory_cache.hpp"
+
+namespace duckdb {
+
+// Extension of index files written next to their archive
+auto const ZIP_INDEX_EXTENSION = ".zipidx";
+
+// Index files hold a zip archive's parsed central directory, so that a new
+// process can open the archive without reading and parsing the end of it.
+// They are written by zipfs_build_index, either next to the archive or in
+// zipfs_index_directory, and record the archive's size, last modified time
+// and ETag, so an index of an archive which has since changed is ignored.
+
+// Path of the index of the archive at archive_path
+string GetZipIndexPath(ClientContext &context, const string &archive_path);
+
+// Read the index of the archive in handle, if there is a current one
+shared_ptr<ZipDirectory> ReadZipIndex(ClientContext &context,
+                                      FileHandle &handle,
+                                      const string &archive_key);
+
+struct ZipIndexFunctionInfo : public TableFunctionInfo {
+  explicit ZipIndexFunctionInfo(shared_ptr<ZipDirectoryCache> directory_cache)
+      : directory_cache(std::move(directory_cache)) {}
+
+  shared_ptr<ZipDirectoryCache> directory_cache;
+};
+
+void BuildZipIndexFunction(ClientContext &context, TableFunctionInput &data,
+                           DataChunk &output);
+
+unique_ptr<FunctionData>
+BuildZipIndexFunctionBind(ClientContext &context,
+                          TableFunctionBindInput &input,
+                          vector<LogicalType> &return_types,
+                          vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState>
+BuildZipIndexFunctionInit(ClientContext &context,
+                          TableFunctionInitInput &input);
+
+} // namespace duckdb
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/main/client_context_state.hpp"
+#include "buffer_pool.hpp"
+
+namespace duckdb {
+
+struct ZipDirectoryEntry;
+
+// Default largest gap of unrequested bytes bridged when merging entry reads
+const idx_t DEFAULT_COALESCE_GAP = 64 * 1024;
+
+// Default size limit of one merged read
+const idx_t DEFAULT_COALESCE_MAX_SIZE = 16 * 1024 * 1024;
+
+// Where an entry starts and ends in the archive, from its local header up to
+// the next entry
+struct ZipEntryRange {
+  idx_t start;
+  idx_t end;
+};
+
+// A range of the archive covering one or more entries, read in one request
+struct ZipReadSegment {
+  idx_t start;
+  idx_t end;
+  // Loaded on first use, under lock
+  PooledBuffer data;
+  mutex lock;
+};
+
+// Raw bytes of an entry, from its local header up to the next entry
+struct ZipEntryBytes {
+  // Keeps the data alive
+  shared_ptr<ZipReadSegment> segment;
+  const data_t *data = nullptr;
+  idx_t len = 0;
+};
+
+// Coalesced reads for the entries matched by a glob. Entries are sorted by
+// offset and neighbouring entries are merged into one segment, so opening
+// thousands of small entries takes a handful of reads of the archive rather
+// than two reads per entry.
+class ZipReadPlan final {
+public:
+  // Add the given entries to the plan
+  void Plan(vector<ZipEntryRange> entries, idx_t max_gap, idx_t max_size);
+
+  // If the entry is part of the plan, get its bytes, reading its segment
+  // from handle if this is the first entry of the segment to be opened. Each
+  // planned entry is handed out once.
+  bool TryTake(FileHandle &handle, const ZipDirectoryEntry &entry,
+               ZipEntryBytes &result);
+
+private:
+  mutex lock;
+  // Segments by the local header offset of the entries they cover
+  unordered_map<idx_t, shared_ptr<ZipReadSegment>> planned;
+};
+
+// The read plans of the archives globbed by the current query, by archive
+// (see GetArchiveKey). Plans are dropped when the query ends, and segments
+// not read by then are freed once the handles holding them are closed.
+class ZipReadPlans final : public ClientContextState {
+public:
+  // Get the plans of the query running in context
+  static ZipReadPlans &Get(ClientContext &context);
+
+  // Plan of the archive, created if create is set and otherwise nullptr if
+  // the archive was not globbed
+  shared_ptr<ZipReadPlan> GetPlan(const string &archive_key, bool create);
+
+  void QueryEnd() override;
+
+private:
+  mutex lock;
+  unordered_map<string, shared_ptr<ZipReadPlan>> plans;
+};
+
+} // namespace duckdb
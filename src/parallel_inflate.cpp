@@ -0,0 +1,681 @@
+#include "parallel_inflate.hpp"
+#include "utils.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+
+namespace duckdb {
+
+static const idx_t WINDOW_SIZE = 32768;
+static const idx_t MAX_BITS = 15;
+// Codes up to this long are decoded with a single table lookup
+static const idx_t FAST_BITS = 10;
+static const idx_t MAX_LENGTH_CODES = 288;
+static const idx_t MAX_DISTANCE_CODES = 30;
+
+static const uint16_t LENGTH_BASE[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23,  27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[MAX_DISTANCE_CODES] = {
+    1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+    33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[MAX_DISTANCE_CODES] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8,  7, 9,
+                                              6,  10, 5,  11, 4, 12, 3,
+                                              13, 2,  14, 1,  15};
+
+// Reads bits least significant first. Past the end of the data it reads
+// zeros, so that hot loops need no bounds checks; callers check Overrun.
+struct BitReader {
+  BitReader(const data_t *in, idx_t in_size, idx_t bit_pos)
+      : in(in), in_size(in_size), pos(bit_pos / 8), buf(0), count(0) {
+    Refill();
+    Consume(bit_pos % 8);
+  }
+
+  // Hold at least 57 bits
+  void Refill() {
+    while (count <= 56) {
+      uint64_t byte = pos < in_size ? in[pos] : 0;
+      buf |= byte << count;
+      pos++;
+      count += 8;
+    }
+  }
+
+  void Consume(idx_t n) {
+    buf >>= n;
+    count -= n;
+  }
+
+  uint32_t Bits(idx_t n) {
+    if (count < n) {
+      Refill();
+    }
+    auto value = static_cast<uint32_t>(buf & ((1ULL << n) - 1));
+    Consume(n);
+    return value;
+  }
+
+  idx_t Position() const { return pos * 8 - count; }
+  bool Overrun() const { return Position() > in_size * 8; }
+
+  // Skip to the next byte, then read from byte_pos on
+  void SeekByte(idx_t byte_pos) {
+    pos = byte_pos;
+    buf = 0;
+    count = 0;
+    Refill();
+  }
+
+  const data_t *in;
+  idx_t in_size;
+  // Next byte to load into buf
+  idx_t pos;
+  uint64_t buf;
+  idx_t count;
+};
+
+struct HuffmanTable {
+  // The symbol << 4 | length of codes up to FAST_BITS long, indexed by the
+  // next FAST_BITS bits. 0 for longer or unused codes.
+  uint16_t fast[1 << FAST_BITS];
+  // Number of codes of each length
+  uint16_t count[MAX_BITS + 1];
+  // Symbols ordered by code
+  uint16_t symbol[MAX_LENGTH_CODES];
+  // Number of codes left unused, 0 for a complete code
+  int64_t unused;
+
+  // Build the decoding table from code lengths. Returns false if the lengths
+  // are over-subscribed. Incomplete codes are built, decoding an unused code
+  // fails instead.
+  bool Build(const uint8_t *lengths, idx_t n) {
+    memset(count, 0, sizeof(count));
+    for (idx_t s = 0; s < n; s++) {
+      count[lengths[s]]++;
+    }
+    count[0] = 0;
+    unused = 1;
+    for (idx_t len = 1; len <= MAX_BITS; len++) {
+      unused <<= 1;
+      unused -= count[len];
+      if (unused < 0) {
+        return false;
+      }
+    }
+    uint16_t offsets[MAX_BITS + 1];
+    uint32_t next_code[MAX_BITS + 1];
+    offsets[1] = 0;
+    next_code[1] = 0;
+    for (idx_t len = 1; len < MAX_BITS; len++) {
+      offsets[len + 1] = offsets[len] + count[len];
+      next_code[len + 1] = (next_code[len] + count[len]) << 1;
+    }
+    memset(fast, 0, sizeof(fast));
+    for (idx_t s = 0; s < n; s++) {
+      idx_t len = lengths[s];
+      if (len == 0) {
+        continue;
+      }
+      symbol[offsets[len]++] = static_cast<uint16_t>(s);
+      auto code = next_code[len]++;
+      if (len > FAST_BITS) {
+        continue;
+      }
+      // Codes are stored most significant bit first
+      uint32_t reversed = 0;
+      for (idx_t i = 0; i < len; i++) {
+        reversed |= ((code >> i) & 1) << (len - 1 - i);
+      }
+      auto entry = static_cast<uint16_t>(s << 4 | len);
+      for (auto i = reversed; i < (1U << FAST_BITS); i += 1U << len) {
+        fast[i] = entry;
+      }
+    }
+    return true;
+  }
+
+  // Returns -1 for an unused code
+  int32_t Decode(BitReader &reader) const {
+    if (reader.count < MAX_BITS) {
+      reader.Refill();
+    }
+    auto entry = fast[reader.buf & ((1 << FAST_BITS) - 1)];
+    if (entry) {
+      reader.Consume(entry & 15);
+      return entry >> 4;
+    }
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (idx_t len = 1; len <= MAX_BITS; len++) {
+      code |= static_cast<int32_t>((reader.buf >> (len - 1)) & 1);
+      int32_t len_count = count[len];
+      if (code - len_count < first) {
+        reader.Consume(len);
+        return symbol[index + (code - first)];
+      }
+      index += len_count;
+      first += len_count;
+      first <<= 1;
+      code <<= 1;
+    }
+    return -1;
+  }
+};
+
+static const HuffmanTable &FixedLengthTable() {
+  static const HuffmanTable table = [] {
+    uint8_t lengths[MAX_LENGTH_CODES];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    HuffmanTable result;
+    result.Build(lengths, MAX_LENGTH_CODES);
+    return result;
+  }();
+  return table;
+}
+
+static const HuffmanTable &FixedDistanceTable() {
+  static const HuffmanTable table = [] {
+    uint8_t lengths[MAX_DISTANCE_CODES];
+    memset(lengths, 5, MAX_DISTANCE_CODES);
+    HuffmanTable result;
+    result.Build(lengths, MAX_DISTANCE_CODES);
+    return result;
+  }();
+  return table;
+}
+
+// Where no block starts
+static const idx_t NO_BOUNDARY = DConstants::INVALID_INDEX;
+
+// How far into a chunk to look for a block start. Encoders end blocks long
+// before this, so data without a dynamic block this long is stored or uses
+// fixed codes throughout.
+static const idx_t BLOCK_SEARCH_SIZE = 1024 * 1024;
+
+// Output of a ChunkInflater, grown as needed
+template <class T> class ChunkBuffer {
+public:
+  virtual ~ChunkBuffer() = default;
+  // Resize to hold size values, keeping those held. Returns nullptr if there
+  // is no memory for them.
+  virtual T *Resize(idx_t size) = 0;
+};
+
+// Scratch output of trial decoding, which stops after a block
+class ScratchBuffer final : public ChunkBuffer<uint16_t> {
+public:
+  uint16_t *Resize(idx_t size) override {
+    values.resize(size);
+    return values.data();
+  }
+
+private:
+  vector<uint16_t> values;
+};
+
+// Output of a chunk, which can be as large as the whole output, so it is
+// allocated from the buffer manager and counts towards the memory limit
+class ManagedChunkBuffer final : public ChunkBuffer<uint16_t> {
+public:
+  explicit ManagedChunkBuffer(BufferManager &buffer_manager)
+      : buffer_manager(buffer_manager) {}
+
+  uint16_t *Resize(idx_t size) override {
+    auto bytes = MaxValue<idx_t>(size, 1) * sizeof(uint16_t);
+    try {
+      if (!pin.IsValid()) {
+        pin = buffer_manager.Allocate(MemoryTag::EXTENSION, bytes);
+      } else {
+        auto block = pin.GetBlockHandle();
+        buffer_manager.ReAllocate(block, bytes);
+      }
+    } catch (OutOfMemoryException &ex) {
+      // Inflated on a single thread instead
+      return nullptr;
+    }
+    return Data();
+  }
+
+  uint16_t *Data() const { return reinterpret_cast<uint16_t *>(pin.Ptr()); }
+
+  void Free() { pin.Destroy(); }
+
+private:
+  BufferManager &buffer_manager;
+  BufferHandle pin;
+};
+
+// Inflates blocks from a bit position. With T = data_t the output before the
+// start position must be empty. With T = uint16_t it is unknown, and values
+// from 256 on stand for byte (value - 256) of the 32 KiB window before the
+// start position.
+template <class T> class ChunkInflater {
+public:
+  // Output into a buffer of fixed size
+  ChunkInflater(const data_t *in, idx_t in_size, idx_t start_bit, T *out,
+                idx_t out_size)
+      : reader(in, in_size, start_bit), out(out), out_pos(0),
+        out_capacity(out_size), max_output(out_size), buffer(nullptr) {}
+  // Output into a buffer grown as needed, up to max_output values, from
+  // initial_size on
+  ChunkInflater(const data_t *in, idx_t in_size, idx_t start_bit,
+                ChunkBuffer<T> &buffer, idx_t initial_size, idx_t max_output)
+      : reader(in, in_size, start_bit), out(buffer.Resize(initial_size)),
+        out_pos(0), out_capacity(out ? initial_size : 0),
+        max_output(max_output), buffer(&buffer) {}
+
+  // Inflate until a block would start at stop_bit, or to the end of the final
+  // block when stop_bit is NO_BOUNDARY, which must use up the data. Returns
+  // false if the data is invalid or stop_bit is not at a block boundary.
+  bool Run(idx_t stop_bit) {
+    while (true) {
+      auto position = reader.Position();
+      if (stop_bit != NO_BOUNDARY && position >= stop_bit) {
+        return position == stop_bit;
+      }
+      if (reader.Overrun()) {
+        return false;
+      }
+      bool last = reader.Bits(1);
+      if (!Block()) {
+        return false;
+      }
+      if (last) {
+        return stop_bit == NO_BOUNDARY &&
+               (reader.Position() + 7) / 8 == reader.in_size;
+      }
+    }
+  }
+
+  // Whether a non-final dynamic block plausibly starts at the start position:
+  // its header describes complete codes, it decodes, and what follows can be
+  // the header of another block
+  bool IsBlockStart() {
+    if (reader.Bits(3) != 4 || !DynamicBlock(true) ||
+        reader.Position() + 3 > reader.in_size * 8) {
+      return false;
+    }
+    reader.Bits(1);
+    return reader.Bits(2) != 3;
+  }
+
+  // Number of values output
+  idx_t Size() const { return out_pos; }
+
+private:
+  bool Block() {
+    switch (reader.Bits(2)) {
+    case 0:
+      return StoredBlock();
+    case 1:
+      return Codes(FixedLengthTable(), FixedDistanceTable());
+    case 2:
+      return DynamicBlock(false);
+    default:
+      return false;
+    }
+  }
+
+  bool Reserve(idx_t n) {
+    if (out_pos + n <= out_capacity) {
+      return true;
+    }
+    if (!buffer || out_pos + n > max_output) {
+      return false;
+    }
+    auto new_size = MaxValue<idx_t>(out_capacity * 2, out_pos + n);
+    new_size = MinValue<idx_t>(MaxValue<idx_t>(new_size, 65536), max_output);
+    out = buffer->Resize(new_size);
+    out_capacity = out ? new_size : 0;
+    return out != nullptr;
+  }
+
+  bool StoredBlock() {
+    auto byte_pos = (reader.Position() + 7) / 8;
+    if (byte_pos + 4 > reader.in_size) {
+      return false;
+    }
+    auto in = reader.in + byte_pos;
+    idx_t len = in[0] | (in[1] << 8);
+    idx_t nlen = in[2] | (in[3] << 8);
+    byte_pos += 4;
+    if (len != (~nlen & 0xffff) || len > reader.in_size - byte_pos ||
+        !Reserve(len)) {
+      return false;
+    }
+    for (idx_t i = 0; i < len; i++) {
+      out[out_pos + i] = in[4 + i];
+    }
+    out_pos += len;
+    reader.SeekByte(byte_pos + len);
+    return true;
+  }
+
+  bool DynamicBlock(bool strict) {
+    idx_t hlit = reader.Bits(5) + 257;
+    idx_t hdist = reader.Bits(5) + 1;
+    idx_t hclen = reader.Bits(4) + 4;
+    if (hlit > 286 || hdist > MAX_DISTANCE_CODES) {
+      return false;
+    }
+    uint8_t code_lengths[19] = {0};
+    for (idx_t i = 0; i < hclen; i++) {
+      code_lengths[CODE_LENGTH_ORDER[i]] =
+          static_cast<uint8_t>(reader.Bits(3));
+    }
+    if (strict) {
+      // Rule out incomplete codes before building a table for them
+      idx_t kraft_sum = 0;
+      for (auto len : code_lengths) {
+        kraft_sum += len ? 1 << (7 - len) : 0;
+      }
+      if (kraft_sum != 128) {
+        return false;
+      }
+    }
+    HuffmanTable codes;
+    if (!codes.Build(code_lengths, 19)) {
+      return false;
+    }
+    uint8_t lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES];
+    idx_t n = 0;
+    while (n < hlit + hdist) {
+      auto symbol = codes.Decode(reader);
+      if (symbol < 0) {
+        return false;
+      }
+      if (symbol < 16) {
+        lengths[n++] = static_cast<uint8_t>(symbol);
+        continue;
+      }
+      uint8_t value = 0;
+      idx_t repeat;
+      if (symbol == 16) {
+        if (n == 0) {
+          return false;
+        }
+        value = lengths[n - 1];
+        repeat = 3 + reader.Bits(2);
+      } else if (symbol == 17) {
+        repeat = 3 + reader.Bits(3);
+      } else {
+        repeat = 11 + reader.Bits(7);
+      }
+      if (n + repeat > hlit + hdist) {
+        return false;
+      }
+      memset(lengths + n, value, repeat);
+      n += repeat;
+    }
+    if (lengths[256] == 0) {
+      return false;
+    }
+    HuffmanTable literals;
+    HuffmanTable distances;
+    if (!literals.Build(lengths, hlit) ||
+        !distances.Build(lengths + hlit, hdist)) {
+      return false;
+    }
+    if (strict) {
+      // Encoders build complete codes, except for a single distance code
+      idx_t distance_codes = 0;
+      for (idx_t len = 1; len <= MAX_BITS; len++) {
+        distance_codes += distances.count[len];
+      }
+      if (literals.unused != 0 ||
+          (distances.unused != 0 && distance_codes > 1)) {
+        return false;
+      }
+    }
+    return Codes(literals, distances);
+  }
+
+  bool Codes(const HuffmanTable &literals, const HuffmanTable &distances) {
+    while (!reader.Overrun()) {
+      auto symbol = literals.Decode(reader);
+      if (symbol < 256) {
+        if (symbol < 0 || !Reserve(1)) {
+          return false;
+        }
+        out[out_pos++] = static_cast<T>(symbol);
+        continue;
+      }
+      if (symbol == 256) {
+        return true;
+      }
+      symbol -= 257;
+      if (symbol >= 29) {
+        return false;
+      }
+      idx_t len = LENGTH_BASE[symbol] + reader.Bits(LENGTH_EXTRA[symbol]);
+      auto distance_symbol = distances.Decode(reader);
+      if (distance_symbol < 0 ||
+          distance_symbol >= static_cast<int32_t>(MAX_DISTANCE_CODES)) {
+        return false;
+      }
+      idx_t distance = DISTANCE_BASE[distance_symbol] +
+                       reader.Bits(DISTANCE_EXTRA[distance_symbol]);
+      if (!Reserve(len) || !Copy(distance, len)) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool Copy(idx_t distance, idx_t len) {
+    auto dst = out + out_pos;
+    if (distance <= out_pos) {
+      auto src = dst - distance;
+      if (distance >= len) {
+        memcpy(dst, src, len * sizeof(T));
+      } else {
+        // Overlaps, repeating the last distance values
+        for (idx_t i = 0; i < len; i++) {
+          dst[i] = src[i];
+        }
+      }
+      out_pos += len;
+      return true;
+    }
+    if (sizeof(T) == 1 || distance > out_pos + WINDOW_SIZE) {
+      return false;
+    }
+    for (idx_t i = 0; i < len; i++) {
+      auto from = static_cast<int64_t>(out_pos + i) -
+                  static_cast<int64_t>(distance);
+      dst[i] = from < 0 ? static_cast<T>(256 + WINDOW_SIZE + from)
+                        : out[from];
+    }
+    out_pos += len;
+    return true;
+  }
+
+  BitReader reader;
+  T *out;
+  idx_t out_pos;
+  idx_t out_capacity;
+  idx_t max_output;
+  ChunkBuffer<T> *buffer;
+};
+
+// Find the first bit in [from_bit, to_bit) where a block seems to start
+static idx_t FindBlockStart(const data_t *in, idx_t in_size, idx_t from_bit,
+                            idx_t to_bit, idx_t max_output) {
+  ScratchBuffer scratch;
+  for (auto bit = from_bit; bit < to_bit && bit / 8 + 4 <= in_size; bit++) {
+    // Rule out most positions without decoding: a non-final dynamic block
+    // (bits 001) with at most 286 literal/length and 30 distance codes
+    auto p = in + bit / 8;
+    uint32_t bits = (p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24) >>
+                    (bit % 8);
+    if ((bits & 7) != 4 || ((bits >> 3) & 31) > 29 ||
+        ((bits >> 8) & 31) > 29) {
+      continue;
+    }
+    ChunkInflater<uint16_t> trial(in, in_size, bit, scratch, 0, max_output);
+    if (trial.IsBlockStart()) {
+      return bit;
+    }
+  }
+  return NO_BOUNDARY;
+}
+
+bool ParallelInflate(BufferManager &buffer_manager, const data_t *comp_data,
+                     idx_t comp_size, data_t *out, idx_t out_size,
+                     idx_t thread_count, idx_t chunk_size) {
+  auto chunk_count = MinValue<idx_t>(thread_count, comp_size / chunk_size);
+  if (chunk_count < 2) {
+    return false;
+  }
+  auto chunk_bytes = comp_size / chunk_count;
+
+  // Guess where a block starts in each chunk but the first. Chunks where
+  // none is found are inflated as part of the chunk before.
+  vector<idx_t> starts(chunk_count, 0);
+  ParallelFor(thread_count, chunk_count - 1, [&](idx_t i) {
+    auto from = (i + 1) * chunk_bytes * 8;
+    auto to = from + MinValue(chunk_bytes, BLOCK_SEARCH_SIZE) * 8;
+    starts[i + 1] =
+        FindBlockStart(comp_data, comp_size, from, to, out_size);
+  });
+  starts.erase(std::remove(starts.begin(), starts.end(), NO_BOUNDARY),
+               starts.end());
+  chunk_count = starts.size();
+  if (chunk_count < 2) {
+    return false;
+  }
+
+  // Inflate each chunk up to where the next one starts. The first chunk
+  // goes straight to out, the rest with their windows unresolved.
+  vector<unique_ptr<ManagedChunkBuffer>> chunks(chunk_count);
+  vector<idx_t> sizes(chunk_count, 0);
+  vector<uint8_t> valid(chunk_count, false);
+  ParallelFor(thread_count, chunk_count, [&](idx_t i) {
+    auto stop = i + 1 < chunk_count ? starts[i + 1] : NO_BOUNDARY;
+    if (i == 0) {
+      ChunkInflater<data_t> inflater(comp_data, comp_size, 0, out, out_size);
+      valid[i] = inflater.Run(stop);
+      sizes[i] = inflater.Size();
+      return;
+    }
+    // Room for typical compression ratios up front, grown if needed
+    chunks[i] = make_uniq<ManagedChunkBuffer>(buffer_manager);
+    auto initial_size = MinValue<idx_t>(out_size, chunk_bytes * 4);
+    ChunkInflater<uint16_t> inflater(comp_data, comp_size, starts[i],
+                                     *chunks[i], initial_size, out_size);
+    valid[i] = inflater.Run(stop);
+    sizes[i] = inflater.Size();
+  });
+  vector<idx_t> offsets(chunk_count, 0);
+  idx_t total = 0;
+  for (idx_t i = 0; i < chunk_count; i++) {
+    if (!valid[i] || sizes[i] > out_size - total) {
+      return false;
+    }
+    offsets[i] = total;
+    total += sizes[i];
+  }
+  if (total != out_size) {
+    return false;
+  }
+
+  // Resolve the window references of chunk i from out, up to its end
+  auto resolve = [&](idx_t i, idx_t begin, idx_t end) {
+    auto window = static_cast<int64_t>(offsets[i]) - int64_t(WINDOW_SIZE);
+    auto symbols = chunks[i]->Data();
+    auto dst = out + offsets[i];
+    for (auto j = begin; j < end; j++) {
+      auto symbol = symbols[j];
+      if (symbol < 256) {
+        dst[j] = static_cast<data_t>(symbol);
+        continue;
+      }
+      auto from = window + (symbol - 256);
+      if (from < 0) {
+        return false;
+      }
+      dst[j] = out[from];
+    }
+    return true;
+  };
+  // The last 32 KiB of each chunk in order first, which make up the windows
+  // of the chunks after, then the rest of each chunk in parallel
+  for (idx_t i = 1; i < chunk_count; i++) {
+    auto tail = sizes[i] > WINDOW_SIZE ? sizes[i] - WINDOW_SIZE : 0;
+    if (!resolve(i, tail, sizes[i])) {
+      return false;
+    }
+  }
+  vector<uint8_t> resolved(chunk_count, true);
+  ParallelFor(thread_count, chunk_count - 1, [&](idx_t i) {
+    auto tail = sizes[i + 1] > WINDOW_SIZE ? sizes[i + 1] - WINDOW_SIZE : 0;
+    resolved[i + 1] = resolve(i + 1, 0, tail);
+    chunks[i + 1]->Free();
+  });
+  return std::find(resolved.begin(), resolved.end(), false) ==
+         resolved.end();
+}
+
+bool ParseGzipHeader(const data_t *data, idx_t size, idx_t &header_size) {
+  if (size < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8 ||
+      (data[3] & 0xe0) != 0) {
+    return false;
+  }
+  auto flags = data[3];
+  idx_t pos = 10;
+  if (flags & 4) {
+    // Extra field
+    if (pos + 2 > size) {
+      header_size = size + 1;
+      return true;
+    }
+    pos += 2 + (data[pos] | (data[pos + 1] << 8));
+  }
+  for (uint8_t flag : {8, 16}) {
+    // File name, then comment, both zero terminated
+    if (flags & flag) {
+      while (pos < size && data[pos] != 0) {
+        pos++;
+      }
+      pos++;
+    }
+  }
+  if (flags & 2) {
+    // Header CRC
+    pos += 2;
+  }
+  header_size = pos;
+  return true;
+}
+
+bool ParseGzipMember(const data_t *data, idx_t size, GzipMember &member) {
+  idx_t header_size;
+  if (size < 18 || !ParseGzipHeader(data, size - 8, header_size) ||
+      header_size > size - 8) {
+    return false;
+  }
+  auto end = size - 8;
+  auto load32 = [&](idx_t ofs) {
+    return uint32_t(data[ofs]) | uint32_t(data[ofs + 1]) << 8 |
+           uint32_t(data[ofs + 2]) << 16 | uint32_t(data[ofs + 3]) << 24;
+  };
+  member.data_offset = header_size;
+  member.data_size = end - header_size;
+  member.crc32 = load32(end);
+  member.uncomp_size = load32(end + 4);
+  return true;
+}
+
+} // namespace duckdb
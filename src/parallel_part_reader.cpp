@@ -0,0 +1,693 @@
+#include "parallel_part_reader.hpp"
+#include "parallel_inflate.hpp"
+#include "zip_directory_cache.hpp"
+#include "utils.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include <miniz/miniz.h>
+
+#ifdef ENABLE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace duckdb {
+
+// Initial size of the output of a part, doubled as needed
+static const idx_t PART_OUTPUT_SIZE = 64 * 1024;
+// Bytes read from the start of a file to tell its format
+static const idx_t PART_PROBE_SIZE = 4096;
+
+using PartOutputAllocator = ParallelPartReader::OutputAllocator;
+
+bool ParallelPartReader::OutputAllocator::Grow(Part &part, idx_t size) {
+  if (size > max_part_size) {
+    part.too_large = true;
+    return false;
+  }
+  auto added = size - part.output_capacity;
+  auto total = batch_output.fetch_add(added) + added;
+  if (!part.first && total > PART_MAX_BATCH_OUTPUT_SIZE) {
+    batch_output -= added;
+    part.deferred = true;
+    return false;
+  }
+  try {
+    if (!part.output.IsValid()) {
+      part.output = buffer_manager.Allocate(MemoryTag::EXTENSION, size);
+    } else {
+      auto block = part.output.GetBlockHandle();
+      buffer_manager.ReAllocate(block, size);
+    }
+  } catch (OutOfMemoryException &ex) {
+    batch_output -= added;
+    // Parts after the first are decompressed again once those before them
+    // are passed on
+    if (part.first) {
+      part.too_large = true;
+    } else {
+      part.deferred = true;
+    }
+    return false;
+  }
+  part.output_capacity = size;
+  return true;
+}
+
+// Grow the output of a part to PART_OUTPUT_SIZE at first, then to twice its
+// size, up to the largest part. Returns false if it cannot grow.
+static bool GrowPartOutput(PartOutputAllocator &allocator,
+                           ParallelPartReader::Part &part) {
+  auto capacity = part.output_capacity;
+  if (capacity >= allocator.max_part_size) {
+    part.too_large = true;
+    return false;
+  }
+  auto size = capacity == 0 ? PART_OUTPUT_SIZE : capacity * 2;
+  return allocator.Grow(part, MinValue(size, allocator.max_part_size));
+}
+
+//------------------------------------------------------------------------------
+// gzip
+//------------------------------------------------------------------------------
+
+// Byte positions from from on where a gzip member may start
+static vector<idx_t> FindGzipStarts(const data_t *data, idx_t size,
+                                    idx_t from) {
+  vector<idx_t> starts;
+  auto pos = from;
+  while (pos + 4 <= size) {
+    auto match =
+        static_cast<const data_t *>(memchr(data + pos, 0x1f, size - 3 - pos));
+    if (!match) {
+      break;
+    }
+    pos = idx_t(match - data);
+    if (data[pos + 1] == 0x8b && data[pos + 2] == 8 &&
+        (data[pos + 3] & 0xe0) == 0) {
+      starts.push_back(pos);
+    }
+    pos++;
+  }
+  return starts;
+}
+
+// Inflate the member starting at part.start up to its trailer, which has to
+// match the output
+static void DecodeGzipPart(const data_t *data, idx_t size, bool at_end,
+                           PartOutputAllocator &allocator,
+                           ParallelPartReader::Part &part) {
+  auto start = part.start / 8;
+  idx_t header_size;
+  if (!ParseGzipHeader(data + start, size - start, header_size)) {
+    // Cut off before the flags were read, or not a gzip header
+    part.valid = !at_end && size - start < 10;
+    return;
+  }
+  if (header_size > size - start) {
+    part.valid = !at_end;
+    return;
+  }
+
+  tinfl_decompressor inflator;
+  tinfl_init(&inflator);
+  if (!GrowPartOutput(allocator, part)) {
+    return;
+  }
+  auto in_pos = start + header_size;
+  idx_t out_pos = 0;
+  // The whole output is the window, so it can grow between calls
+  mz_uint32 flags = TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+  if (!at_end) {
+    flags |= TINFL_FLAG_HAS_MORE_INPUT;
+  }
+  while (true) {
+    size_t in_bytes = size - in_pos;
+    size_t out_bytes = part.output_capacity - out_pos;
+    auto output = part.output.Ptr();
+    auto status =
+        tinfl_decompress(&inflator, data + in_pos, &in_bytes, output,
+                         output + out_pos, &out_bytes, flags);
+    in_pos += in_bytes;
+    out_pos += out_bytes;
+    if (status == TINFL_STATUS_DONE) {
+      break;
+    }
+    if (status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+      if (!GrowPartOutput(allocator, part)) {
+        return;
+      }
+      continue;
+    }
+    // Cut off, or invalid
+    part.valid = status == TINFL_STATUS_NEEDS_MORE_INPUT && !at_end;
+    return;
+  }
+  if (in_pos + 8 > size) {
+    part.valid = !at_end;
+    return;
+  }
+  part.output_size = out_pos;
+  auto crc = ZipCrc32(part.output.Ptr(), out_pos);
+  part.valid = crc == LoadLE32(data + in_pos) &&
+               static_cast<uint32_t>(out_pos) == LoadLE32(data + in_pos + 4);
+  part.complete = true;
+  part.end = (in_pos + 8) * 8;
+}
+
+bool ParallelPartReader::DecodeGzipBatch() {
+  auto data = batch.data();
+  auto size = batch.size();
+  auto at_end = AtEnd();
+  auto starts = FindGzipStarts(data, size, position / 8);
+  vector<Part> candidates(starts.size());
+  ParallelFor(thread_count, starts.size(), [&](idx_t i) {
+    candidates[i].start = starts[i] * 8;
+    // Only the first can be chained from position
+    candidates[i].first = i == 0;
+    DecodeGzipPart(data, size, at_end, allocator, candidates[i]);
+  });
+
+  idx_t next = 0;
+  while (true) {
+    auto pos = position / 8;
+    while (next < starts.size() && starts[next] < pos) {
+      next++;
+    }
+    if (next == starts.size() || starts[next] != pos) {
+      if (!at_end && pos + 4 > size) {
+        // The next header is cut off
+        return true;
+      }
+      // Anything but another member after a member is ignored, as by gzip
+      done = true;
+      return true;
+    }
+    auto &part = candidates[next];
+    if (part.too_large) {
+      too_large = true;
+      return true;
+    }
+    if (part.deferred) {
+      return true;
+    }
+    if (!part.valid) {
+      return false;
+    }
+    if (!part.complete) {
+      return true;
+    }
+    position = part.end;
+    parts.push_back(std::move(part));
+  }
+}
+
+//------------------------------------------------------------------------------
+// bzip2
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_BZIP2
+// bzip2 blocks and the end of a stream start with these 48 bits, which are
+// not byte aligned
+static const uint64_t BZIP2_BLOCK_MAGIC = 0x314159265359ULL;
+static const uint64_t BZIP2_END_MAGIC = 0x177245385090ULL;
+static const idx_t BZIP2_MAGIC_BITS = 48;
+
+struct Bzip2Magic {
+  idx_t bit;
+  // Whether it ends a stream rather than starting a block
+  bool end;
+};
+
+// Bit positions from from_bit on holding a block or end of stream magic
+static vector<Bzip2Magic> FindBzip2Magics(const data_t *data, idx_t size,
+                                          idx_t from_bit) {
+  vector<Bzip2Magic> magics;
+  const uint64_t mask = (1ULL << BZIP2_MAGIC_BITS) - 1;
+  uint64_t window = 0;
+  for (auto i = from_bit / 8; i < size; i++) {
+    window = window << 8 | data[i];
+    // Magics ending within this byte, earliest first
+    for (idx_t shift = 8; shift-- > 0;) {
+      auto value = (window >> shift) & mask;
+      if (value != BZIP2_BLOCK_MAGIC && value != BZIP2_END_MAGIC) {
+        continue;
+      }
+      auto end_bit = (i + 1) * 8 - shift;
+      if (end_bit >= from_bit + BZIP2_MAGIC_BITS) {
+        magics.push_back(
+            {end_bit - BZIP2_MAGIC_BITS, value == BZIP2_END_MAGIC});
+      }
+    }
+  }
+  return magics;
+}
+
+// Read count bits (up to 32) most significant first
+static uint32_t PeekBits(const data_t *data, idx_t bit, idx_t count) {
+  auto byte = bit / 8;
+  auto bytes = (bit % 8 + count + 7) / 8;
+  uint64_t value = 0;
+  for (idx_t i = 0; i < bytes; i++) {
+    value = value << 8 | data[byte + i];
+  }
+  value >>= bytes * 8 - bit % 8 - count;
+  return static_cast<uint32_t>(value & ((1ULL << count) - 1));
+}
+
+// Writes bits most significant first
+class Bzip2BitWriter {
+public:
+  explicit Bzip2BitWriter(vector<data_t> &out) : out(out) {}
+
+  void Write(uint32_t value, idx_t count) {
+    bits = bits << count | value;
+    bit_count += count;
+    while (bit_count >= 8) {
+      bit_count -= 8;
+      out.push_back(static_cast<data_t>(bits >> bit_count));
+    }
+    bits &= (1ULL << bit_count) - 1;
+  }
+
+  void Flush() {
+    if (bit_count > 0) {
+      out.push_back(static_cast<data_t>(bits << (8 - bit_count)));
+    }
+    bits = 0;
+    bit_count = 0;
+  }
+
+private:
+  vector<data_t> &out;
+  uint64_t bits = 0;
+  idx_t bit_count = 0;
+};
+
+// Decompress the block in bits [part.start, part.end) as a stream of its own:
+// a stream header, the block, and the end of the stream, whose CRC for a
+// single block is the block's own CRC
+static void DecodeBzip2Part(const data_t *data, PartOutputAllocator &allocator,
+                            ParallelPartReader::Part &part) {
+  vector<data_t> stream;
+  stream.reserve((part.end - part.start) / 8 + 32);
+  Bzip2BitWriter writer(stream);
+  // The largest block size, which any block fits
+  for (auto c : {'B', 'Z', 'h', '9'}) {
+    writer.Write(static_cast<uint32_t>(c), 8);
+  }
+  auto bit = part.start;
+  for (; bit + 32 <= part.end; bit += 32) {
+    writer.Write(PeekBits(data, bit, 32), 32);
+  }
+  if (bit < part.end) {
+    writer.Write(PeekBits(data, bit, part.end - bit), part.end - bit);
+  }
+  writer.Write(static_cast<uint32_t>(BZIP2_END_MAGIC >> 24), 24);
+  writer.Write(static_cast<uint32_t>(BZIP2_END_MAGIC & 0xffffff), 24);
+  writer.Write(PeekBits(data, part.start + BZIP2_MAGIC_BITS, 32), 32);
+  writer.Flush();
+
+  bz_stream bz;
+  memset(&bz, 0, sizeof(bz));
+  if (BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK) {
+    throw InternalException("Failed to initialize bzip2 decompression");
+  }
+  if (!GrowPartOutput(allocator, part)) {
+    BZ2_bzDecompressEnd(&bz);
+    return;
+  }
+  bz.next_in = (char *)stream.data();
+  bz.avail_in = static_cast<unsigned int>(stream.size());
+  idx_t out_pos = 0;
+  int result;
+  while (true) {
+    bz.next_out = (char *)(part.output.Ptr() + out_pos);
+    bz.avail_out = static_cast<unsigned int>(part.output_capacity - out_pos);
+    result = BZ2_bzDecompress(&bz);
+    out_pos = part.output_capacity - bz.avail_out;
+    if (result != BZ_OK) {
+      break;
+    }
+    if (bz.avail_out > 0) {
+      // All input used without reaching the end of the stream
+      break;
+    }
+    if (!GrowPartOutput(allocator, part)) {
+      break;
+    }
+  }
+  BZ2_bzDecompressEnd(&bz);
+  part.output_size = out_pos;
+  part.valid = result == BZ_STREAM_END && !part.too_large && !part.deferred;
+  part.complete = true;
+}
+#endif
+
+bool ParallelPartReader::DecodeBzip2Batch() {
+#ifdef ENABLE_BZIP2
+  auto data = batch.data();
+  auto size = batch.size();
+  auto at_end = AtEnd();
+  auto magics = FindBzip2Magics(data, size, position);
+  // Each block ends where the next magic starts
+  vector<Part> blocks(magics.size());
+  vector<idx_t> block_magics;
+  for (idx_t i = 0; i + 1 < magics.size(); i++) {
+    if (!magics[i].end) {
+      blocks[i].start = magics[i].bit;
+      blocks[i].end = magics[i + 1].bit;
+      block_magics.push_back(i);
+    }
+  }
+  ParallelFor(thread_count, block_magics.size(), [&](idx_t i) {
+    // Only the first can be chained from position
+    blocks[block_magics[i]].first = i == 0;
+    DecodeBzip2Part(data, allocator, blocks[block_magics[i]]);
+  });
+
+  idx_t next = 0;
+  while (true) {
+    auto pos = position / 8;
+    if (position % 8 == 0 && pos + 4 <= size &&
+        memcmp(data + pos, "BZh", 3) == 0 && data[pos + 3] >= '1' &&
+        data[pos + 3] <= '9') {
+      // Stream header, ahead of the first block
+      position += 32;
+      continue;
+    }
+    while (next < magics.size() && magics[next].bit < position) {
+      next++;
+    }
+    if (!at_end && position + 80 > size * 8) {
+      // The next header or magic may be cut off
+      return true;
+    }
+    if (next == magics.size() || magics[next].bit != position) {
+      // Anything but another stream after a stream is ignored, as by bzip2
+      done = true;
+      return true;
+    }
+    if (magics[next].end) {
+      // The end of stream magic and CRC, then padding to a whole byte
+      position = (position + BZIP2_MAGIC_BITS + 32 + 7) / 8 * 8;
+      continue;
+    }
+    if (next + 1 == magics.size()) {
+      // The block's end is not in the batch
+      return !at_end;
+    }
+    auto &block = blocks[next];
+    if (block.deferred) {
+      return true;
+    }
+    // Data within a block may look like a magic, splitting it in two, in
+    // which case the block is decompressed again up to a later magic
+    for (auto end = next + 2; !block.valid && !block.too_large &&
+                              end < magics.size() && end <= next + 4;
+         end++) {
+      Part merged;
+      merged.start = block.start;
+      merged.end = magics[end].bit;
+      // Next to be passed on, as the first part of a batch would be
+      merged.first = true;
+      DecodeBzip2Part(data, allocator, merged);
+      if (merged.valid) {
+        block = std::move(merged);
+      }
+    }
+    if (block.too_large) {
+      too_large = true;
+      return true;
+    }
+    if (!block.valid) {
+      return !at_end && next + 4 >= magics.size();
+    }
+    position = block.end;
+    parts.push_back(std::move(block));
+  }
+#else
+  return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// zstd
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_ZSTD
+// Number of whole frames from the start of data
+static idx_t CountZstdFrames(const data_t *data, idx_t size) {
+  idx_t count = 0;
+  idx_t pos = 0;
+  while (pos < size) {
+    auto frame_size = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+    if (ZSTD_isError(frame_size)) {
+      break;
+    }
+    count++;
+    pos += frame_size;
+  }
+  return count;
+}
+
+static void DecodeZstdPart(const data_t *data, PartOutputAllocator &allocator,
+                           ParallelPartReader::Part &part) {
+  auto frame = data + part.start / 8;
+  auto frame_size = (part.end - part.start) / 8;
+  part.complete = true;
+  auto content_size = ZSTD_getFrameContentSize(frame, frame_size);
+  if (content_size != ZSTD_CONTENTSIZE_UNKNOWN &&
+      content_size != ZSTD_CONTENTSIZE_ERROR) {
+    // The size in the frame header is only trusted up to the limit
+    if (content_size == 0) {
+      part.valid = true;
+      return;
+    }
+    if (!allocator.Grow(part, content_size)) {
+      return;
+    }
+    part.output_size = content_size;
+    part.valid = ZipDecompressor::Create(ZIP_METHOD_ZSTD, "")
+                     ->Decompress(frame, frame_size, part.output.Ptr(),
+                                  content_size);
+    return;
+  }
+  // The frame's size is not recorded
+  auto context = ZSTD_createDCtx();
+  if (!context) {
+    throw InternalException("Failed to allocate zstd decompressor");
+  }
+  if (!GrowPartOutput(allocator, part)) {
+    ZSTD_freeDCtx(context);
+    return;
+  }
+  ZSTD_inBuffer in = {frame, frame_size, 0};
+  ZSTD_outBuffer out = {part.output.Ptr(), part.output_capacity, 0};
+  size_t result;
+  while (true) {
+    result = ZSTD_decompressStream(context, &out, &in);
+    if (ZSTD_isError(result) || result == 0) {
+      break;
+    }
+    if (out.pos < out.size) {
+      // All input used without reaching the end of the frame
+      break;
+    }
+    if (!GrowPartOutput(allocator, part)) {
+      break;
+    }
+    out.dst = part.output.Ptr();
+    out.size = part.output_capacity;
+  }
+  ZSTD_freeDCtx(context);
+  part.output_size = out.pos;
+  part.valid = result == 0 && !part.too_large && !part.deferred;
+}
+#endif
+
+bool ParallelPartReader::DecodeZstdBatch() {
+#ifdef ENABLE_ZSTD
+  auto data = batch.data();
+  auto size = batch.size();
+  // Frames record the sizes of their blocks, so are found exactly
+  vector<Part> frames;
+  auto pos = position / 8;
+  while (pos < size) {
+    auto frame_size = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+    if (ZSTD_isError(frame_size)) {
+      if (AtEnd()) {
+        return false;
+      }
+      // Cut off
+      break;
+    }
+    Part frame;
+    frame.start = pos * 8;
+    frame.end = (pos + frame_size) * 8;
+    frames.push_back(std::move(frame));
+    pos += frame_size;
+  }
+  ParallelFor(thread_count, frames.size(), [&](idx_t i) {
+    frames[i].first = i == 0;
+    DecodeZstdPart(data, allocator, frames[i]);
+  });
+  for (auto &frame : frames) {
+    if (frame.too_large) {
+      too_large = true;
+      return true;
+    }
+    if (frame.deferred) {
+      return true;
+    }
+    if (!frame.valid) {
+      return false;
+    }
+    position = frame.end;
+    parts.push_back(std::move(frame));
+  }
+  done = pos == size && AtEnd();
+  return true;
+#else
+  return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Parallel Part Reader
+//------------------------------------------------------------------------------
+
+ParallelPartReader::ParallelPartReader(BufferManager &buffer_manager,
+                                       FileHandle &handle, idx_t thread_count,
+                                       idx_t max_part_size)
+    : handle(handle), thread_count(thread_count),
+      max_part_size(MinValue(max_part_size, PART_MAX_OUTPUT_SIZE)),
+      allocator(buffer_manager, this->max_part_size),
+      file_size(handle.GetFileSize()), format(Format::GZIP),
+      batch_size(
+          MinValue(thread_count * PART_BATCH_SIZE, PART_MAX_BATCH_SIZE)),
+      batch_offset(0), position(0), done(false), too_large(false) {}
+
+bool ParallelPartReader::Start() {
+  if (thread_count <= 1) {
+    return false;
+  }
+  // Tell the format from the start of the file before reading a whole batch
+  data_t probe[PART_PROBE_SIZE];
+  auto probe_size = MinValue(PART_PROBE_SIZE, file_size);
+  handle.Read(probe, probe_size, 0);
+  idx_t header_size;
+  if (ParseGzipHeader(probe, probe_size, header_size)) {
+    format = Format::GZIP;
+#ifdef ENABLE_BZIP2
+  } else if (probe_size >= 10 && memcmp(probe, "BZh", 3) == 0 &&
+             PeekBits(probe, 32, 32) == BZIP2_BLOCK_MAGIC >> 16) {
+    format = Format::BZIP2;
+#endif
+#ifdef ENABLE_ZSTD
+  } else if (probe_size >= 4 && LoadLE32(probe) == 0xfd2fb528) {
+    format = Format::ZSTD;
+    if (ZSTD_findFrameCompressedSize(probe, probe_size) == file_size) {
+      // A single small frame
+      return false;
+    }
+#endif
+  } else {
+    return false;
+  }
+
+  // Only decompress files made of several parts, found without decompressing
+  FillBatch();
+  auto data = batch.data();
+  auto size = batch.size();
+  switch (format) {
+  case Format::GZIP:
+    if (FindGzipStarts(data, size, 0).size() < 2) {
+      return false;
+    }
+    break;
+#ifdef ENABLE_BZIP2
+  case Format::BZIP2:
+    if (FindBzip2Magics(data, size, 0).size() < 3) {
+      return false;
+    }
+    break;
+#endif
+#ifdef ENABLE_ZSTD
+  case Format::ZSTD:
+    if (CountZstdFrames(data, size) < 2) {
+      return false;
+    }
+    break;
+#endif
+  default:
+    return false;
+  }
+  return DecodeBatch() && !too_large && parts.size() >= 2;
+}
+
+bool ParallelPartReader::Read(const ZipOutputFunction &output) {
+  while (true) {
+    for (auto &part : parts) {
+      if (part.output_size > 0) {
+        output(part.output.Ptr(), part.output_size);
+      }
+    }
+    parts.clear();
+    if (too_large) {
+      return false;
+    }
+    if (done) {
+      return true;
+    }
+    FillBatch();
+    if (!DecodeBatch()) {
+      throw IOException("Failed to decompress at offset %llu",
+                        batch_offset + position / 8);
+    }
+    if (parts.empty() && !done && !too_large) {
+      if (AtEnd()) {
+        throw IOException("Truncated compressed file");
+      }
+      if (batch_size >= PART_MAX_BATCH_SIZE) {
+        // A part larger than the largest batch
+        too_large = true;
+        continue;
+      }
+      batch_size = MinValue(batch_size * 2, PART_MAX_BATCH_SIZE);
+    }
+  }
+}
+
+void ParallelPartReader::FillBatch() {
+  auto used = position / 8;
+  batch.erase(batch.begin(), batch.begin() + used);
+  batch_offset += used;
+  position -= used * 8;
+  auto old_size = batch.size();
+  auto new_size =
+      MinValue(MaxValue(batch_size, old_size), file_size - batch_offset);
+  batch.resize(new_size);
+  if (new_size > old_size) {
+    handle.Read(batch.data() + old_size, new_size - old_size,
+                batch_offset + old_size);
+  }
+}
+
+bool ParallelPartReader::DecodeBatch() {
+  allocator.Reset();
+  switch (format) {
+  case Format::GZIP:
+    return DecodeGzipBatch();
+  case Format::BZIP2:
+    return DecodeBzip2Batch();
+  case Format::ZSTD:
+    return DecodeZstdBatch();
+  default:
+    throw InternalException("Unknown compressed file format");
+  }
+}
+
+} // namespace duckdb
@@ -1,4 +1,5 @@
 #include "archive_file_system.hpp"
+#include "zip_decompressor.hpp"
 
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/numeric_utils.hpp"
@@ -10,6 +11,19 @@
 
 namespace duckdb {
 
+struct archive *OpenRawArchive(LibArchiveHandle &handle,
+                               struct archive_entry *&entry) {
+  struct archive *archive = OpenLibArchive(handle, true);
+  entry = archive_entry_new2(archive);
+  if (archive_read_next_header2(archive, entry) != ARCHIVE_OK) {
+    archive_entry_free(entry);
+    entry = nullptr;
+    archive_read_free(archive);
+    throw IOException("Failed to find file inside compressed file");
+  }
+  return archive;
+}
+
 bool RawArchiveFileSystem::CanHandleFile(const string &fpath) {
   // TODO: Check that we can seek into the file
   return fpath.size() > 13 && fpath.substr(0, 13) == "compressed://";
@@ -49,83 +63,83 @@ RawArchiveFileSystem::OpenFile(const string &path, FileOpenFlags flags,
   auto file_type = fs.GetFileType(*handle);
   auto on_disk_file = handle->OnDiskFile();
 
-  struct archive *archive = archive_read_new();
-  try {
-    if (archive_read_support_filter_all(archive)) {
-      throw IOException("Failed to init libarchive (filter all): %s",
-                        archive_error_string(archive));
-    }
-
-    if (archive_read_support_format_raw(archive)) {
-      throw IOException("Failed to init libarchive (format raw): %s",
-                        archive_error_string(archive));
-    }
-    unique_ptr<LibArchiveHandle> zipHandle =
-        make_uniq<LibArchiveHandle>(std::move(handle));
-    // TODO: Add skip?
-    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-      throw IOException("Failed to init libarchive (seek callback): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-      throw IOException("Failed to init libarchive (read callback): %s",
-                        archive_error_string(archive));
-    }
-    struct archive_entry *entry = archive_entry_new2(archive);
-    try {
-      bool found = false;
-      if (archive_read_next_header2(archive, entry) == ARCHIVE_OK) {
-        found = true;
+  auto &buffer_manager = BufferManager::GetBufferManager(*context);
+  string cache_key;
+  auto cache_size = GetSizeSetting(*context, "zipfs_entry_cache_size",
+                                   DEFAULT_ENTRY_CACHE_SIZE);
+  if (cache_size > 0) {
+    cache_key = GetArchiveKey(*handle);
+    auto cached = entry_cache->Get(cache_key);
+    if (cached) {
+      // Unless the buffer manager evicted it since it was cached
+      auto pin = cached->Pin();
+      if (pin.IsValid()) {
+        return make_uniq<ArchiveFileHandle>(
+            *this, path, flags, last_modified_time, has_last_modified_time,
+            file_type, on_disk_file, std::move(cached), std::move(pin));
       }
-      if (!found) {
-        throw IOException("Failed to find file inside compressed file");
-      }
-
-      unique_ptr<data_t[]> read_buf;
-      la_int64_t read_buf_size;
-      ReadArchiveEntryFully(archive, entry, &read_buf, &read_buf_size);
-
-      auto zip_file_handle = make_uniq<ArchiveFileHandle>(
-          *this, path, flags, last_modified_time, has_last_modified_time,
-          file_type, on_disk_file, read_buf_size, std::move(read_buf));
+    }
+  }
 
-      archive_entry_free(entry);
-      archive_read_free(archive);
+  // BGZF and seekable zstd files are read a block at a time as needed
+  auto seekable = SeekableCompressedFile::TryOpen(
+      fs, file_path, handle,
+      GetStringSetting(*context, "zipfs_inflate_backend",
+                       DEFAULT_INFLATE_BACKEND),
+      entry_cache);
+  if (seekable) {
+    return make_uniq<ArchiveFileHandle>(
+        *this, path, flags, last_modified_time, has_last_modified_time,
+        file_type, on_disk_file, buffer_manager, std::move(seekable));
+  }
 
-      return zip_file_handle;
-    } catch (Exception &ex2) {
-      archive_entry_free(entry);
-      throw;
-    }
-  } catch (Exception &ex) {
-    archive_read_free(archive);
-    throw;
+  auto spill = GetSpillOptions(*context);
+  auto thread_count = NumericCast<idx_t>(
+      TaskScheduler::GetScheduler(*context).NumberOfThreads());
+  auto parallel_members =
+      GetBoolSetting(*context, "zipfs_parallel_members", false);
+  auto parallel_inflate =
+      GetBoolSetting(*context, "zipfs_parallel_inflate", false);
+  auto stream_buffer_size =
+      GetSizeSetting(*context, "zipfs_stream_buffer_size", 0);
+
+  unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+      std::move(handle), GetBoolSetting(*context, "zipfs_mmap", false));
+  struct archive_entry *entry;
+  struct archive *archive = OpenRawArchive(*zipHandle, entry);
+  // The file is decompressed when first read, or as it is read when streamed
+  auto result = make_uniq<ArchiveFileHandle>(
+      *this, path, flags, last_modified_time, has_last_modified_time,
+      file_type, on_disk_file, archive, entry, std::move(zipHandle),
+      entry_cache, cache_key, cache_size, buffer_manager, std::move(spill));
+  if (parallel_members) {
+    result->part_threads = thread_count;
   }
+  if (parallel_inflate) {
+    result->inflate_threads = thread_count;
+  }
+  result->stream_buffer_size = stream_buffer_size;
+  return std::move(result);
 }
 
 void RawArchiveFileSystem::Read(FileHandle &handle, void *buffer,
                                 int64_t nr_bytes, idx_t location) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  auto remaining_bytes = t_handle.sz - location;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + location, to_read);
+  t_handle.ReadAt(buffer, UnsafeNumericCast<idx_t>(nr_bytes), location);
 }
 
 int64_t RawArchiveFileSystem::Read(FileHandle &handle, void *buffer,
                                    int64_t nr_bytes) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  auto position = t_handle.seek_offset;
-  auto remaining_bytes = t_handle.sz - position;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + position, to_read);
-  t_handle.seek_offset += to_read;
-  return to_read;
+  auto read_bytes = t_handle.ReadAt(
+      buffer, UnsafeNumericCast<idx_t>(nr_bytes), t_handle.seek_offset);
+  t_handle.seek_offset += read_bytes;
+  return UnsafeNumericCast<int64_t>(read_bytes);
 }
 
 int64_t RawArchiveFileSystem::GetFileSize(FileHandle &handle) {
   auto &t_handle = handle.Cast<ArchiveFileHandle>();
-  return UnsafeNumericCast<int64_t>(t_handle.sz);
+  return UnsafeNumericCast<int64_t>(t_handle.GetSize());
 }
 
 void RawArchiveFileSystem::Seek(FileHandle &handle, idx_t location) {
@@ -215,53 +229,18 @@ bool RawArchiveFileSystem::FileExists(const string &filename,
     return false;
   }
 
-  idx_t size = handle->GetFileSize();
-
-  struct archive *archive = archive_read_new();
+  unique_ptr<LibArchiveHandle> zipHandle = make_uniq<LibArchiveHandle>(
+      std::move(handle), GetBoolSetting(*context, "zipfs_mmap", false));
+  struct archive_entry *entry;
+  struct archive *archive;
   try {
-    if (archive_read_support_filter_all(archive)) {
-      throw IOException("Failed to init libarchive (filter all): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_support_format_raw(archive)) {
-      throw IOException("Failed to init libarchive (format raw): %s",
-                        archive_error_string(archive));
-    }
-    unique_ptr<LibArchiveHandle> zipHandle =
-        make_uniq<LibArchiveHandle>(std::move(handle));
-    // TODO: Add skip?
-    if (archive_read_set_seek_callback(archive, FileSystemZipSeekFunc)) {
-      throw IOException("Failed to init libarchive (seek callback): %s",
-                        archive_error_string(archive));
-    }
-    if (archive_read_open(archive, zipHandle.get(), &FileSystemZipOpenFunc,
-                          &FileSystemZipReadFunc, &FileSystemZipCloseFunc)) {
-      throw IOException("Failed to init libarchive (read callback): %s",
-                        archive_error_string(archive));
-    }
-    struct archive_entry *entry = archive_entry_new2(archive);
-    try {
-      bool found = false;
-
-      if (archive_read_next_header2(archive, entry) == ARCHIVE_OK) {
-        found = true;
-      }
-
-      archive_entry_free(entry);
-      archive_read_free(archive);
-
-      return found;
-    } catch (Exception &ex2) {
-      archive_entry_free(entry);
-      throw;
-    }
+    archive = OpenRawArchive(*zipHandle, entry);
   } catch (IOException &ex) {
-    archive_read_free(archive);
     return false;
-  } catch (Exception &ex) {
-    archive_read_free(archive);
-    throw;
   }
+  archive_entry_free(entry);
+  archive_read_free(archive);
+  return true;
 }
 
 } // namespace duckdb
@@ -0,0 +1,370 @@
+#include "seekable_compressed_file.hpp"
+#include "buffer_pool.hpp"
+#include "zip_decompressor.hpp"
+#include "zip_directory_cache.hpp"
+
+#include "duckdb/common/exception.hpp"
+
+namespace duckdb {
+
+//------------------------------------------------------------------------------
+// Formats
+//------------------------------------------------------------------------------
+
+// Bytes read from the start of a file to recognize a BGZF header, which is 18
+// bytes unless it holds more extra fields
+static const idx_t BGZF_PROBE_SIZE = 64;
+
+// Parse the gzip header of a BGZF block. Returns false unless it has the BC
+// extra field holding the size of the block. header_size is more than size
+// when the header is cut off.
+static bool ParseBgzfHeader(const data_t *data, idx_t size,
+                            idx_t &header_size, idx_t &block_size) {
+  header_size = 0;
+  // Magic, deflate, and extra fields but no name, comment or header CRC,
+  // which bgzip does not write
+  if (size < 12 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8 ||
+      (data[3] & 0x1e) != 0x04) {
+    return false;
+  }
+  header_size = 12 + LoadLE16(data + 10);
+  if (header_size > size) {
+    return false;
+  }
+  for (idx_t pos = 12; pos + 4 <= header_size;) {
+    auto field_size = LoadLE16(data + pos + 2);
+    if (data[pos] == 'B' && data[pos + 1] == 'C' && field_size == 2 &&
+        pos + 6 <= header_size) {
+      block_size = idx_t(LoadLE16(data + pos + 4)) + 1;
+      // The deflate data, CRC and size have to fit
+      return block_size >= header_size + 8;
+    }
+    pos += 4 + field_size;
+  }
+  return false;
+}
+
+// zstd's seekable format ends with a skippable frame holding a table of the
+// sizes of the frames before it
+static const uint32_t ZSTD_SKIPPABLE_MAGIC = 0x184d2a5e;
+static const uint32_t ZSTD_SEEKABLE_MAGIC = 0x8f92eab1;
+static const idx_t ZSTD_SEEK_TABLE_FOOTER_SIZE = 9;
+
+//------------------------------------------------------------------------------
+// Seekable Compressed File
+//------------------------------------------------------------------------------
+
+SeekableCompressedFile::SeekableCompressedFile(
+    FileSystem &fs, string path, unique_ptr<FileHandle> handle, Format format,
+    string inflate_backend, shared_ptr<EntryCache> index_cache)
+    : fs(fs), path(std::move(path)), handle(std::move(handle)),
+      format(format), inflate_backend(std::move(inflate_backend)),
+      index_cache(std::move(index_cache)), complete(false),
+      next_cache_slot(0) {
+  building = make_shared_ptr<BlockIndex>();
+  building->comp_offsets = {0};
+  building->offsets = {0};
+  index = building;
+}
+
+unique_ptr<SeekableCompressedFile>
+SeekableCompressedFile::TryOpen(FileSystem &fs, const string &path,
+                                unique_ptr<FileHandle> &handle,
+                                const string &inflate_backend,
+                                shared_ptr<EntryCache> index_cache) {
+  auto file_size = handle->GetFileSize();
+  vector<data_t> probe(MinValue(file_size, BGZF_PROBE_SIZE));
+  handle->Read(probe.data(), probe.size(), 0);
+  idx_t header_size;
+  idx_t block_size;
+  auto is_bgzf =
+      ParseBgzfHeader(probe.data(), probe.size(), header_size, block_size);
+  if (!is_bgzf && header_size > probe.size() && header_size <= file_size) {
+    // A header with more extra fields
+    probe.resize(header_size);
+    handle->Read(probe.data(), probe.size(), 0);
+    is_bgzf =
+        ParseBgzfHeader(probe.data(), probe.size(), header_size, block_size);
+  }
+  if (is_bgzf) {
+    auto index_key = GetArchiveKey(*handle);
+    unique_ptr<SeekableCompressedFile> file(
+        new SeekableCompressedFile(fs, path, std::move(handle), Format::BGZF,
+                                   inflate_backend, std::move(index_cache)));
+    file->index_key = std::move(index_key);
+    auto cached = file->index_cache->GetIndex(file->index_key);
+    if (cached) {
+      file->index = std::move(cached);
+      file->building.reset();
+      file->complete = true;
+      return file;
+    }
+    if (file->LoadIndex()) {
+      return file;
+    }
+    // Other gzip members follow, left to be read as a stream
+    handle = std::move(file->handle);
+    return nullptr;
+  }
+#ifdef ENABLE_ZSTD
+  if (probe.size() >= 4 && LoadLE32(probe.data()) == 0xfd2fb528 &&
+      file_size >= ZSTD_SEEK_TABLE_FOOTER_SIZE + 8) {
+    unique_ptr<SeekableCompressedFile> file(
+        new SeekableCompressedFile(fs, path, std::move(handle), Format::ZSTD,
+                                   inflate_backend, std::move(index_cache)));
+    if (file->ReadSeekTable()) {
+      file->building.reset();
+      file->complete = true;
+      return file;
+    }
+    // A plain zstd file
+    handle = std::move(file->handle);
+  }
+#endif
+  return nullptr;
+}
+
+idx_t SeekableCompressedFile::GetSize() {
+  if (!complete) {
+    lock_guard<mutex> guard(index_lock);
+    if (!complete && !ScanBgzfBlocks(NumericLimits<idx_t>::Maximum())) {
+      throw IOException("Not a BGZF block at offset %llu in %s",
+                        index->comp_offsets.back(), path);
+    }
+  }
+  return index->offsets.back();
+}
+
+bool SeekableCompressedFile::FindBlock(idx_t location, Block &block) {
+  unique_lock<mutex> guard(index_lock, std::defer_lock);
+  if (!complete) {
+    guard.lock();
+    if (!complete && index->offsets.back() <= location &&
+        !ScanBgzfBlocks(location)) {
+      throw IOException("Not a BGZF block at offset %llu in %s",
+                        index->comp_offsets.back(), path);
+    }
+  }
+  auto &offsets = index->offsets;
+  if (location >= offsets.back()) {
+    return false;
+  }
+  // The last block starting at or before location, past empty blocks such
+  // as the one ending a BGZF file
+  auto i = NumericCast<idx_t>(
+      std::upper_bound(offsets.begin(), offsets.end(), location) -
+      offsets.begin() - 1);
+  block.index = i;
+  block.comp_offset = index->comp_offsets[i];
+  block.comp_size = index->comp_offsets[i + 1] - block.comp_offset;
+  block.offset = offsets[i];
+  block.size = offsets[i + 1] - block.offset;
+  return true;
+}
+
+idx_t SeekableCompressedFile::ReadAt(void *buffer, idx_t nr_bytes,
+                                     idx_t location) {
+  auto out = static_cast<data_t *>(buffer);
+  idx_t done = 0;
+  Block block;
+  while (done < nr_bytes && FindBlock(location + done, block)) {
+    auto skip = location + done - block.offset;
+    auto count = MinValue(block.size - skip, nr_bytes - done);
+    if (skip == 0 && count == block.size) {
+      // Whole blocks are decompressed straight into the buffer
+      DecompressBlock(block, out + done);
+    } else {
+      auto data = GetBlock(block);
+      memcpy(out + done, data->data() + skip, count);
+    }
+    done += count;
+  }
+  return done;
+}
+
+bool SeekableCompressedFile::LoadIndex() {
+  if (!ReadGziIndex()) {
+    building->comp_offsets = {0};
+    building->offsets = {0};
+  }
+  return ScanBgzfBlocks(0);
+}
+
+bool SeekableCompressedFile::ReadGziIndex() {
+  // As written by bgzip --reindex: the number of entries, then the compressed
+  // and decompressed offset of each block after the first
+  auto gzi_path = path + ".gzi";
+  if (!fs.FileExists(gzi_path)) {
+    return false;
+  }
+  auto gzi_handle = fs.OpenFile(gzi_path, FileOpenFlags::FILE_FLAGS_READ);
+  auto gzi_size = gzi_handle->GetFileSize();
+  if (gzi_size < 8) {
+    return false;
+  }
+  auto gzi = BufferPool::Get().Allocate(gzi_size);
+  gzi_handle->Read(gzi.get(), gzi_size, 0);
+  auto count = LoadLE64(gzi.get());
+  if (count > (gzi_size - 8) / 16 || gzi_size != 8 + count * 16) {
+    return false;
+  }
+  auto file_size = handle->GetFileSize();
+  auto &comp_offsets = building->comp_offsets;
+  auto &offsets = building->offsets;
+  comp_offsets = {0};
+  offsets = {0};
+  for (idx_t i = 0; i < count; i++) {
+    auto comp_offset = LoadLE64(gzi.get() + 8 + i * 16);
+    auto offset = LoadLE64(gzi.get() + 16 + i * 16);
+    // An index of another file is ignored
+    if (comp_offset <= comp_offsets.back() || comp_offset >= file_size ||
+        offset < offsets.back()) {
+      return false;
+    }
+    comp_offsets.push_back(comp_offset);
+    offsets.push_back(offset);
+  }
+  return true;
+}
+
+bool SeekableCompressedFile::ScanBgzfBlocks(idx_t target) {
+  auto file_size = handle->GetFileSize();
+  auto &comp_offsets = building->comp_offsets;
+  auto &offsets = building->offsets;
+  // Headers are checked from the last block in the index on, and again as
+  // each block is decompressed
+  auto pos = comp_offsets.back();
+  auto offset = offsets.back();
+  comp_offsets.pop_back();
+  offsets.pop_back();
+  vector<data_t> buffer;
+  idx_t buffer_offset = 0;
+  bool valid = true;
+  while (pos < file_size) {
+    if (pos + (1 << 16) > buffer_offset + buffer.size() &&
+        buffer_offset + buffer.size() < file_size) {
+      if (!buffer.empty() && offset > target) {
+        break;
+      }
+      // The largest block may not be in the buffer
+      buffer_offset = pos;
+      buffer.resize(MinValue(BGZF_SCAN_SIZE, file_size - pos));
+      handle->Read(buffer.data(), buffer.size(), buffer_offset);
+    }
+    auto data = buffer.data() + (pos - buffer_offset);
+    auto available = buffer_offset + buffer.size() - pos;
+    idx_t header_size;
+    idx_t block_size;
+    if (!ParseBgzfHeader(data, available, header_size, block_size) ||
+        block_size > available) {
+      valid = false;
+      break;
+    }
+    comp_offsets.push_back(pos);
+    offsets.push_back(offset);
+    pos += block_size;
+    offset += LoadLE32(data + block_size - 4);
+  }
+  // The end of the index, where the scan goes on from
+  comp_offsets.push_back(pos);
+  offsets.push_back(offset);
+  if (valid && pos == file_size) {
+    index_cache->PutIndex(index_key, building);
+    building.reset();
+    complete = true;
+  }
+  return valid;
+}
+
+bool SeekableCompressedFile::ReadSeekTable() {
+  auto file_size = handle->GetFileSize();
+  data_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+  handle->Read(footer, ZSTD_SEEK_TABLE_FOOTER_SIZE,
+               file_size - ZSTD_SEEK_TABLE_FOOTER_SIZE);
+  auto frame_count = LoadLE32(footer);
+  auto descriptor = footer[4];
+  if (LoadLE32(footer + 5) != ZSTD_SEEKABLE_MAGIC ||
+      (descriptor & 0x7f) != 0) {
+    return false;
+  }
+  // Each entry holds the compressed and decompressed size of a frame, and
+  // optionally a checksum, which is not checked as frames hold their own
+  idx_t entry_size = descriptor & 0x80 ? 12 : 8;
+  auto table_size = idx_t(frame_count) * entry_size +
+                    ZSTD_SEEK_TABLE_FOOTER_SIZE;
+  if (table_size + 8 > file_size) {
+    return false;
+  }
+  auto table_offset = file_size - table_size;
+  auto table = BufferPool::Get().Allocate(table_size + 8);
+  handle->Read(table.get(), table_size + 8, table_offset - 8);
+  if (LoadLE32(table.get()) != ZSTD_SKIPPABLE_MAGIC ||
+      LoadLE32(table.get() + 4) != table_size) {
+    return false;
+  }
+  auto &comp_offsets = building->comp_offsets;
+  auto &offsets = building->offsets;
+  for (idx_t i = 0; i < frame_count; i++) {
+    auto entry = table.get() + 8 + i * entry_size;
+    comp_offsets.push_back(comp_offsets.back() + LoadLE32(entry));
+    offsets.push_back(offsets.back() + LoadLE32(entry + 4));
+  }
+  // The frames have to end where the seek table starts
+  return comp_offsets.back() == table_offset - 8;
+}
+
+void SeekableCompressedFile::DecompressBlock(const Block &block,
+                                             data_t *out) {
+  auto comp_offset = block.comp_offset;
+  auto comp_size = block.comp_size;
+  auto size = block.size;
+  auto comp = BufferPool::Get().Allocate(comp_size);
+  handle->Read(comp.get(), comp_size, comp_offset);
+  bool valid;
+  if (format == Format::BGZF) {
+    idx_t header_size;
+    idx_t block_size;
+    valid = ParseBgzfHeader(comp.get(), comp_size, header_size, block_size) &&
+            block_size == comp_size &&
+            LoadLE32(comp.get() + comp_size - 4) == static_cast<uint32_t>(size);
+    if (valid) {
+      auto inflater =
+          ZipDecompressor::Create(ZIP_METHOD_DEFLATE, inflate_backend);
+      valid = inflater->Decompress(comp.get() + header_size,
+                                   comp_size - header_size - 8, out, size) &&
+              ZipCrc32(out, size) == LoadLE32(comp.get() + comp_size - 8);
+    }
+  } else {
+    valid = ZipDecompressor::Create(ZIP_METHOD_ZSTD, "")
+                ->Decompress(comp.get(), comp_size, out, size);
+  }
+  if (!valid) {
+    throw IOException("Failed to decompress block at offset %llu in %s",
+                      comp_offset, path);
+  }
+}
+
+shared_ptr<vector<data_t>>
+SeekableCompressedFile::GetBlock(const Block &block) {
+  {
+    lock_guard<mutex> guard(cache_lock);
+    for (auto &cached : cache) {
+      if (cached.first == block.index) {
+        return cached.second;
+      }
+    }
+  }
+  // Decompressed without the lock, so other threads read on meanwhile
+  auto data = make_shared_ptr<vector<data_t>>(block.size);
+  DecompressBlock(block, data->data());
+  lock_guard<mutex> guard(cache_lock);
+  if (cache.size() < SEEKABLE_BLOCK_CACHE_COUNT) {
+    cache.emplace_back(block.index, data);
+  } else {
+    cache[next_cache_slot] = make_pair(block.index, data);
+    next_cache_slot = (next_cache_slot + 1) % SEEKABLE_BLOCK_CACHE_COUNT;
+  }
+  return data;
+}
+
+} // namespace duckdb
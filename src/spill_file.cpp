@@ -0,0 +1,60 @@
+#include "spill_file.hpp"
+#include "utils.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/types/uuid.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+
+namespace duckdb {
+
+SpillOptions GetSpillOptions(ClientContext &context) {
+  SpillOptions options;
+  options.threshold = GetSizeSetting(context, "zipfs_spill_threshold",
+                                     DEFAULT_SPILL_THRESHOLD);
+  if (options.threshold > 0) {
+    options.fs = &FileSystem::GetFileSystem(context);
+    options.directory =
+        BufferManager::GetBufferManager(context).GetTemporaryDirectory();
+  }
+  return options;
+}
+
+SpillFile::SpillFile(const SpillOptions &options)
+    : fs(*options.fs), size(0) {
+  if (!fs.DirectoryExists(options.directory)) {
+    fs.CreateDirectory(options.directory);
+  }
+  // The temp directory may be shared by several processes, so names are
+  // random and files are never opened if they already exist
+  path = fs.JoinPath(options.directory,
+                     "zipfs_spill_" +
+                         UUID::ToString(UUID::GenerateRandomUUID()) + ".tmp");
+  handle = fs.OpenFile(path, FileFlags::FILE_FLAGS_READ |
+                                 FileFlags::FILE_FLAGS_WRITE |
+                                 FileFlags::FILE_FLAGS_FILE_CREATE |
+                                 FileFlags::FILE_FLAGS_EXCLUSIVE_CREATE);
+  if (!handle) {
+    throw IOException("Failed to create spill file: %s", path);
+  }
+}
+
+SpillFile::~SpillFile() {
+  handle.reset();
+  fs.TryRemoveFile(path);
+}
+
+void SpillFile::Append(const data_t *buffer, idx_t nr_bytes) {
+  handle->Write(const_cast<data_t *>(buffer), nr_bytes, size);
+  size += nr_bytes;
+}
+
+idx_t SpillFile::ReadAt(void *buffer, idx_t nr_bytes, idx_t location) {
+  if (location >= size) {
+    return 0;
+  }
+  auto to_read = MinValue(nr_bytes, size - location);
+  handle->Read(buffer, to_read, location);
+  return to_read;
+}
+
+} // namespace duckdb
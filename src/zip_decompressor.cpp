@@ -0,0 +1,773 @@
+#include "zip_decompressor.hpp"
+#include "buffer_pool.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/limits.hpp"
+#include "duckdb/common/string_util.hpp"
+#include <miniz/miniz.h>
+
+#ifdef ENABLE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef ENABLE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef ENABLE_LZMA
+#include <lzma.h>
+#endif
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace duckdb {
+
+// Size of the input and output buffers when decompressing in pieces
+const idx_t STREAMING_BUFFER_SIZE = 256 * 1024;
+
+uint32_t ZipCrc32(const data_t *data, idx_t size, uint32_t crc) {
+#ifdef ENABLE_LIBDEFLATE
+  return libdeflate_crc32(crc, data, size);
+#else
+  return static_cast<uint32_t>(mz_crc32(crc, data, size));
+#endif
+}
+
+// Most idle contexts kept by a ContextPool
+const idx_t CONTEXT_POOL_MAX_IDLE = 64;
+
+// Keeps decompression contexts, which are costly to allocate, for reuse by
+// later entries. A glob query may open thousands of small entries.
+template <class T> class ContextPool final {
+public:
+  typedef T *(*create_t)();
+  typedef void (*destroy_t)(T *);
+
+  ContextPool(create_t create, destroy_t destroy)
+      : create(create), destroy(destroy) {}
+
+  T *Acquire() {
+    {
+      lock_guard<mutex> guard(lock);
+      if (!idle.empty()) {
+        auto context = idle.back();
+        idle.pop_back();
+        return context;
+      }
+    }
+    return create();
+  }
+
+  void Release(T *context) {
+    {
+      lock_guard<mutex> guard(lock);
+      if (idle.size() < CONTEXT_POOL_MAX_IDLE) {
+        idle.push_back(context);
+        return;
+      }
+    }
+    destroy(context);
+  }
+
+private:
+  create_t create;
+  destroy_t destroy;
+  mutex lock;
+  vector<T *> idle;
+};
+
+bool ZipDecompressor::DecompressStreaming(const ZipInputFunction &input,
+                                          idx_t out_size,
+                                          const ZipOutputFunction &output) {
+  throw InternalException("Streaming decompression is not implemented");
+}
+
+//------------------------------------------------------------------------------
+// Deflate (8)
+//------------------------------------------------------------------------------
+
+// Portable default, always available
+class MinizDecompressor final : public ZipDecompressor {
+public:
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    auto inflated_size = tinfl_decompress_mem_to_mem(out, out_size, comp_data,
+                                                     comp_size, 0);
+    return inflated_size != TINFL_DECOMPRESS_MEM_TO_MEM_FAILED &&
+           inflated_size == out_size;
+  }
+};
+
+#ifdef ENABLE_LIBDEFLATE
+static ContextPool<libdeflate_decompressor> &GetLibdeflatePool() {
+  static auto pool = new ContextPool<libdeflate_decompressor>(
+      [] { return libdeflate_alloc_decompressor(); },
+      [](libdeflate_decompressor *decompressor) {
+        libdeflate_free_decompressor(decompressor);
+      });
+  return *pool;
+}
+
+// Several times faster than miniz, but can only decompress whole buffers
+class LibdeflateDecompressor final : public ZipDecompressor {
+public:
+  LibdeflateDecompressor() : decompressor(GetLibdeflatePool().Acquire()) {
+    if (!decompressor) {
+      throw InternalException("Failed to allocate libdeflate decompressor");
+    }
+  }
+
+  ~LibdeflateDecompressor() override {
+    GetLibdeflatePool().Release(decompressor);
+  }
+
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    size_t inflated_size = 0;
+    auto result = libdeflate_deflate_decompress(
+        decompressor, comp_data, comp_size, out, out_size, &inflated_size);
+    return result == LIBDEFLATE_SUCCESS && inflated_size == out_size;
+  }
+
+private:
+  libdeflate_decompressor *decompressor;
+};
+#endif
+
+//------------------------------------------------------------------------------
+// Deflate64 (9)
+//------------------------------------------------------------------------------
+
+// Deflate with a 64 KiB window, 16 extra bits for length code 285 and two
+// more distance codes. No common library implements it, so this is a small
+// canonical Huffman decoder. The whole output is in memory, so it is also the
+// window.
+class Deflate64Decompressor final : public ZipDecompressor {
+public:
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    in = comp_data;
+    in_size = comp_size;
+    in_pos = 0;
+    bit_buf = 0;
+    bit_count = 0;
+    this->out = out;
+    this->out_size = out_size;
+    out_pos = 0;
+    failed = false;
+
+    bool last = false;
+    while (!last && !failed) {
+      last = Bits(1);
+      switch (Bits(2)) {
+      case 0:
+        StoredBlock();
+        break;
+      case 1:
+        FixedBlock();
+        break;
+      case 2:
+        DynamicBlock();
+        break;
+      default:
+        failed = true;
+      }
+    }
+    return !failed && out_pos == out_size;
+  }
+
+private:
+  static const idx_t MAX_BITS = 15;
+  static const idx_t MAX_LENGTH_CODES = 288;
+  static const idx_t MAX_DISTANCE_CODES = 32;
+
+  struct Huffman {
+    // Number of codes of each length
+    uint16_t count[MAX_BITS + 1];
+    // Symbols ordered by code
+    uint16_t symbol[MAX_LENGTH_CODES];
+  };
+
+  uint32_t Bits(idx_t need) {
+    while (bit_count < need) {
+      if (in_pos == in_size) {
+        failed = true;
+        return 0;
+      }
+      bit_buf |= static_cast<uint64_t>(in[in_pos++]) << bit_count;
+      bit_count += 8;
+    }
+    auto value = static_cast<uint32_t>(bit_buf & ((1ULL << need) - 1));
+    bit_buf >>= need;
+    bit_count -= need;
+    return value;
+  }
+
+  // Build the decoding table from code lengths. Incomplete codes are allowed,
+  // decoding an unused code fails instead.
+  bool Construct(Huffman &huffman, const uint16_t *lengths, idx_t n) {
+    memset(huffman.count, 0, sizeof(huffman.count));
+    for (idx_t symbol = 0; symbol < n; symbol++) {
+      huffman.count[lengths[symbol]]++;
+    }
+    int64_t left = 1;
+    for (idx_t len = 1; len <= MAX_BITS; len++) {
+      left <<= 1;
+      left -= huffman.count[len];
+      if (left < 0) {
+        return false;
+      }
+    }
+    uint16_t offsets[MAX_BITS + 1];
+    offsets[1] = 0;
+    for (idx_t len = 1; len < MAX_BITS; len++) {
+      offsets[len + 1] = offsets[len] + huffman.count[len];
+    }
+    for (idx_t symbol = 0; symbol < n; symbol++) {
+      if (lengths[symbol] != 0) {
+        huffman.symbol[offsets[lengths[symbol]]++] =
+            static_cast<uint16_t>(symbol);
+      }
+    }
+    return true;
+  }
+
+  int32_t Decode(const Huffman &huffman) {
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (idx_t len = 1; len <= MAX_BITS; len++) {
+      code |= static_cast<int32_t>(Bits(1));
+      int32_t count = huffman.count[len];
+      if (code - count < first) {
+        return huffman.symbol[index + (code - first)];
+      }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+    failed = true;
+    return -1;
+  }
+
+  void StoredBlock() {
+    bit_buf = 0;
+    bit_count = 0;
+    if (in_size - in_pos < 4) {
+      failed = true;
+      return;
+    }
+    idx_t len = in[in_pos] | (in[in_pos + 1] << 8);
+    idx_t nlen = in[in_pos + 2] | (in[in_pos + 3] << 8);
+    in_pos += 4;
+    if (len != (~nlen & 0xffff) || len > in_size - in_pos ||
+        len > out_size - out_pos) {
+      failed = true;
+      return;
+    }
+    memcpy(out + out_pos, in + in_pos, len);
+    in_pos += len;
+    out_pos += len;
+  }
+
+  void Codes(const Huffman &lengths, const Huffman &distances) {
+    static const uint16_t LENGTH_BASE[29] = {
+        3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 3};
+    static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                             1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                             4, 4, 4, 4, 5, 5, 5, 5, 16};
+    static const uint32_t DISTANCE_BASE[MAX_DISTANCE_CODES] = {
+        1,    2,    3,    4,    5,    7,     9,     13,    17,    25,   33,
+        49,   65,   97,   129,  193,  257,   385,   513,   769,   1025, 1537,
+        2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 32769, 49153};
+    static const uint8_t DISTANCE_EXTRA[MAX_DISTANCE_CODES] = {
+        0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,  6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14};
+
+    while (!failed) {
+      auto symbol = Decode(lengths);
+      if (symbol < 0) {
+        return;
+      }
+      if (symbol < 256) {
+        if (out_pos == out_size) {
+          failed = true;
+          return;
+        }
+        out[out_pos++] = static_cast<data_t>(symbol);
+        continue;
+      }
+      if (symbol == 256) {
+        return;
+      }
+      symbol -= 257;
+      if (symbol >= 29) {
+        failed = true;
+        return;
+      }
+      idx_t len = LENGTH_BASE[symbol] + Bits(LENGTH_EXTRA[symbol]);
+      symbol = Decode(distances);
+      if (symbol < 0) {
+        return;
+      }
+      idx_t distance = DISTANCE_BASE[symbol] + Bits(DISTANCE_EXTRA[symbol]);
+      if (failed || distance > out_pos || len > out_size - out_pos) {
+        failed = true;
+        return;
+      }
+      // Copy byte by byte, the source may overlap the output
+      auto src = out + out_pos - distance;
+      auto dst = out + out_pos;
+      for (idx_t i = 0; i < len; i++) {
+        dst[i] = src[i];
+      }
+      out_pos += len;
+    }
+  }
+
+  void FixedBlock() {
+    uint16_t lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES];
+    idx_t symbol = 0;
+    for (; symbol < 144; symbol++) {
+      lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+      lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+      lengths[symbol] = 7;
+    }
+    for (; symbol < MAX_LENGTH_CODES; symbol++) {
+      lengths[symbol] = 8;
+    }
+    for (; symbol < MAX_LENGTH_CODES + MAX_DISTANCE_CODES; symbol++) {
+      lengths[symbol] = 5;
+    }
+    Huffman length_codes, distance_codes;
+    Construct(length_codes, lengths, MAX_LENGTH_CODES);
+    Construct(distance_codes, lengths + MAX_LENGTH_CODES, MAX_DISTANCE_CODES);
+    Codes(length_codes, distance_codes);
+  }
+
+  void DynamicBlock() {
+    static const uint8_t ORDER[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+    idx_t nlen = Bits(5) + 257;
+    idx_t ndist = Bits(5) + 1;
+    idx_t ncode = Bits(4) + 4;
+    if (failed || nlen > MAX_LENGTH_CODES || ndist > MAX_DISTANCE_CODES) {
+      failed = true;
+      return;
+    }
+
+    uint16_t lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES];
+    idx_t index = 0;
+    for (; index < ncode; index++) {
+      lengths[ORDER[index]] = static_cast<uint16_t>(Bits(3));
+    }
+    for (; index < 19; index++) {
+      lengths[ORDER[index]] = 0;
+    }
+    Huffman length_codes, distance_codes;
+    if (!Construct(length_codes, lengths, 19)) {
+      failed = true;
+      return;
+    }
+
+    index = 0;
+    while (index < nlen + ndist && !failed) {
+      auto symbol = Decode(length_codes);
+      if (symbol < 0) {
+        return;
+      }
+      if (symbol < 16) {
+        lengths[index++] = static_cast<uint16_t>(symbol);
+        continue;
+      }
+      uint16_t len = 0;
+      idx_t repeat;
+      if (symbol == 16) {
+        if (index == 0) {
+          failed = true;
+          return;
+        }
+        len = lengths[index - 1];
+        repeat = 3 + Bits(2);
+      } else if (symbol == 17) {
+        repeat = 3 + Bits(3);
+      } else {
+        repeat = 11 + Bits(7);
+      }
+      if (index + repeat > nlen + ndist) {
+        failed = true;
+        return;
+      }
+      while (repeat--) {
+        lengths[index++] = len;
+      }
+    }
+    if (failed || lengths[256] == 0 ||
+        !Construct(length_codes, lengths, nlen) ||
+        !Construct(distance_codes, lengths + nlen, ndist)) {
+      failed = true;
+      return;
+    }
+    Codes(length_codes, distance_codes);
+  }
+
+  const data_t *in;
+  idx_t in_size;
+  idx_t in_pos;
+  uint64_t bit_buf;
+  idx_t bit_count;
+  data_t *out;
+  idx_t out_size;
+  idx_t out_pos;
+  bool failed;
+};
+
+//------------------------------------------------------------------------------
+// bzip2 (12)
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_BZIP2
+class Bzip2Decompressor final : public ZipDecompressor {
+public:
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    bz_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK) {
+      return false;
+    }
+    // bzip2 counts in unsigned int, so feed very large entries in pieces
+    const idx_t max_chunk = NumericLimits<unsigned int>::Maximum();
+    idx_t in_pos = 0;
+    idx_t out_pos = 0;
+    int result = BZ_OK;
+    while (result == BZ_OK) {
+      auto in_chunk = MinValue(comp_size - in_pos, max_chunk);
+      auto out_chunk = MinValue(out_size - out_pos, max_chunk);
+      stream.next_in = (char *)(comp_data + in_pos);
+      stream.avail_in = static_cast<unsigned int>(in_chunk);
+      stream.next_out = (char *)(out + out_pos);
+      stream.avail_out = static_cast<unsigned int>(out_chunk);
+      result = BZ2_bzDecompress(&stream);
+      in_pos += in_chunk - stream.avail_in;
+      out_pos += out_chunk - stream.avail_out;
+      if (result == BZ_OK && in_chunk == stream.avail_in &&
+          out_chunk == stream.avail_out) {
+        // No progress, the data is truncated or the output too small
+        break;
+      }
+    }
+    BZ2_bzDecompressEnd(&stream);
+    return result == BZ_STREAM_END && out_pos == out_size;
+  }
+
+  bool DecompressStreaming(const ZipInputFunction &input, idx_t out_size,
+                           const ZipOutputFunction &output) override {
+    bz_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK) {
+      return false;
+    }
+    auto in_buf = BufferPool::Get().Allocate(STREAMING_BUFFER_SIZE);
+    auto out_buf = BufferPool::Get().Allocate(STREAMING_BUFFER_SIZE);
+    idx_t out_pos = 0;
+    bool input_done = false;
+    int result = BZ_OK;
+    while (result == BZ_OK && out_pos <= out_size) {
+      if (stream.avail_in == 0 && !input_done) {
+        auto in_len = input(in_buf.get(), STREAMING_BUFFER_SIZE);
+        input_done = in_len < STREAMING_BUFFER_SIZE;
+        stream.next_in = (char *)in_buf.get();
+        stream.avail_in = static_cast<unsigned int>(in_len);
+      }
+      stream.next_out = (char *)out_buf.get();
+      stream.avail_out = static_cast<unsigned int>(STREAMING_BUFFER_SIZE);
+      result = BZ2_bzDecompress(&stream);
+      auto out_len = STREAMING_BUFFER_SIZE - stream.avail_out;
+      output(out_buf.get(), out_len);
+      out_pos += out_len;
+      if (result == BZ_OK && out_len == 0 && stream.avail_in == 0 &&
+          input_done) {
+        // Truncated
+        break;
+      }
+    }
+    BZ2_bzDecompressEnd(&stream);
+    return result == BZ_STREAM_END && out_pos == out_size;
+  }
+};
+#endif
+
+//------------------------------------------------------------------------------
+// LZMA (14)
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_LZMA
+// Raw LZMA1 preceded by a zip specific header: a 2 byte version, the 2 byte
+// size of the properties and the properties themselves. The data may or may
+// not end with an end marker, so decoding stops once the output is full.
+class LzmaDecompressor final : public ZipDecompressor {
+public:
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    if (comp_size < 4) {
+      return false;
+    }
+    idx_t props_size = comp_data[2] | (comp_data[3] << 8);
+    if (comp_size < 4 + props_size) {
+      return false;
+    }
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (!InitDecoder(stream, comp_data + 4, props_size)) {
+      return false;
+    }
+    stream.next_in = comp_data + 4 + props_size;
+    stream.avail_in = comp_size - 4 - props_size;
+    stream.next_out = out;
+    stream.avail_out = out_size;
+    auto result = LZMA_OK;
+    while (result == LZMA_OK && stream.avail_out > 0) {
+      auto avail_in = stream.avail_in;
+      result = lzma_code(&stream, LZMA_FINISH);
+      if (result == LZMA_OK && avail_in == stream.avail_in &&
+          stream.avail_out > 0) {
+        break;
+      }
+    }
+    auto total_out = stream.total_out;
+    lzma_end(&stream);
+    return (result == LZMA_OK || result == LZMA_STREAM_END) &&
+           total_out == out_size;
+  }
+
+  bool DecompressStreaming(const ZipInputFunction &input, idx_t out_size,
+                           const ZipOutputFunction &output) override {
+    data_t header[4];
+    if (input(header, 4) < 4) {
+      return false;
+    }
+    idx_t props_size = header[2] | (header[3] << 8);
+    auto in_buf = BufferPool::Get().Allocate(
+        MaxValue(STREAMING_BUFFER_SIZE, props_size));
+    if (input(in_buf.get(), props_size) < props_size) {
+      return false;
+    }
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (!InitDecoder(stream, in_buf.get(), props_size)) {
+      return false;
+    }
+    auto out_buf = BufferPool::Get().Allocate(STREAMING_BUFFER_SIZE);
+    bool input_done = false;
+    auto result = LZMA_OK;
+    while (result == LZMA_OK && stream.total_out < out_size) {
+      if (stream.avail_in == 0 && !input_done) {
+        auto in_len = input(in_buf.get(), STREAMING_BUFFER_SIZE);
+        input_done = in_len < STREAMING_BUFFER_SIZE;
+        stream.next_in = in_buf.get();
+        stream.avail_in = in_len;
+      }
+      // Never decode past the end of the entry, which may have no end marker
+      stream.next_out = out_buf.get();
+      stream.avail_out =
+          MinValue(STREAMING_BUFFER_SIZE, out_size - stream.total_out);
+      auto avail_out = stream.avail_out;
+      result = lzma_code(&stream, input_done ? LZMA_FINISH : LZMA_RUN);
+      auto out_len = avail_out - stream.avail_out;
+      output(out_buf.get(), out_len);
+      if (result == LZMA_OK && out_len == 0 && stream.avail_in == 0 &&
+          input_done) {
+        // Truncated
+        break;
+      }
+    }
+    auto total_out = stream.total_out;
+    lzma_end(&stream);
+    return (result == LZMA_OK || result == LZMA_STREAM_END) &&
+           total_out == out_size;
+  }
+
+private:
+  static bool InitDecoder(lzma_stream &stream, const data_t *props,
+                          idx_t props_size) {
+    lzma_filter filters[2];
+    filters[0].id = LZMA_FILTER_LZMA1;
+    filters[0].options = nullptr;
+    filters[1].id = LZMA_VLI_UNKNOWN;
+    filters[1].options = nullptr;
+    if (lzma_properties_decode(&filters[0], nullptr, props, props_size) !=
+        LZMA_OK) {
+      return false;
+    }
+    auto result = lzma_raw_decoder(&stream, filters);
+    free(filters[0].options);
+    return result == LZMA_OK;
+  }
+};
+#endif
+
+//------------------------------------------------------------------------------
+// zstd (93)
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_ZSTD
+static ContextPool<ZSTD_DCtx> &GetZstdPool() {
+  static auto pool = new ContextPool<ZSTD_DCtx>(
+      [] { return ZSTD_createDCtx(); },
+      [](ZSTD_DCtx *context) { ZSTD_freeDCtx(context); });
+  return *pool;
+}
+
+class ZstdDecompressor final : public ZipDecompressor {
+public:
+  ZstdDecompressor() : context(GetZstdPool().Acquire()) {
+    if (!context) {
+      throw InternalException("Failed to allocate zstd decompressor");
+    }
+  }
+
+  ~ZstdDecompressor() override { GetZstdPool().Release(context); }
+
+  bool Decompress(const data_t *comp_data, idx_t comp_size, data_t *out,
+                  idx_t out_size) override {
+    auto result =
+        ZSTD_decompressDCtx(context, out, out_size, comp_data, comp_size);
+    return !ZSTD_isError(result) && result == out_size;
+  }
+
+  bool DecompressStreaming(const ZipInputFunction &input, idx_t out_size,
+                           const ZipOutputFunction &output) override {
+    // A context may be reused mid-stream after an earlier failure
+    ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+    auto in_buf = BufferPool::Get().Allocate(STREAMING_BUFFER_SIZE);
+    auto out_buf = BufferPool::Get().Allocate(STREAMING_BUFFER_SIZE);
+    ZSTD_inBuffer in = {in_buf.get(), 0, 0};
+    idx_t out_pos = 0;
+    bool input_done = false;
+    // 0 once a frame is complete, otherwise a hint of the input still needed
+    size_t result = 1;
+    while (out_pos <= out_size) {
+      if (in.pos == in.size) {
+        if (input_done) {
+          break;
+        }
+        in.size = input(in_buf.get(), STREAMING_BUFFER_SIZE);
+        in.pos = 0;
+        input_done = in.size < STREAMING_BUFFER_SIZE;
+      }
+      ZSTD_outBuffer out = {out_buf.get(), STREAMING_BUFFER_SIZE, 0};
+      result = ZSTD_decompressStream(context, &out, &in);
+      if (ZSTD_isError(result)) {
+        break;
+      }
+      output(out_buf.get(), out.pos);
+      out_pos += out.pos;
+      if (out.pos == 0 && in.pos == in.size && input_done) {
+        break;
+      }
+    }
+    return result == 0 && out_pos == out_size;
+  }
+
+private:
+  ZSTD_DCtx *context;
+};
+#endif
+
+//------------------------------------------------------------------------------
+// Method Selection
+//------------------------------------------------------------------------------
+
+bool ZipDecompressor::IsKnownMethod(uint16_t method) {
+  switch (method) {
+  case ZIP_METHOD_STORED:
+  case ZIP_METHOD_DEFLATE:
+  case ZIP_METHOD_DEFLATE64:
+  case ZIP_METHOD_BZIP2:
+  case ZIP_METHOD_LZMA:
+  case ZIP_METHOD_ZSTD:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ZipDecompressor::CanStream(uint16_t method) {
+  switch (method) {
+  case ZIP_METHOD_BZIP2:
+  case ZIP_METHOD_LZMA:
+  case ZIP_METHOD_ZSTD:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void ZipDecompressor::CheckInflateBackend(const string &backend) {
+  auto name = StringUtil::Lower(backend);
+  if (name == "auto" || name == "miniz") {
+    return;
+  }
+  if (name == "libdeflate") {
+#ifndef ENABLE_LIBDEFLATE
+    throw InvalidInputException(
+        "duckdb-zipfs was not built with libdeflate support.");
+#endif
+    return;
+  }
+  throw InvalidInputException("Unknown zipfs_inflate_backend '%s', expected "
+                              "'auto', 'miniz' or 'libdeflate'",
+                              backend);
+}
+
+static unique_ptr<ZipDecompressor> CreateInflater(const string &backend) {
+  ZipDecompressor::CheckInflateBackend(backend);
+  auto name = StringUtil::Lower(backend);
+  if (name == "miniz") {
+    return make_uniq<MinizDecompressor>();
+  }
+  // libdeflate, which is only accepted if built in, or auto
+#ifdef ENABLE_LIBDEFLATE
+  return make_uniq<LibdeflateDecompressor>();
+#else
+  return make_uniq<MinizDecompressor>();
+#endif
+}
+
+unique_ptr<ZipDecompressor> ZipDecompressor::Create(uint16_t method,
+                                                    const string &backend) {
+  switch (method) {
+  case ZIP_METHOD_DEFLATE:
+    return CreateInflater(backend);
+  case ZIP_METHOD_DEFLATE64:
+    return make_uniq<Deflate64Decompressor>();
+  case ZIP_METHOD_BZIP2:
+#ifdef ENABLE_BZIP2
+    return make_uniq<Bzip2Decompressor>();
+#else
+    throw IOException("duckdb-zipfs was not built with bzip2 support.");
+#endif
+  case ZIP_METHOD_LZMA:
+#ifdef ENABLE_LZMA
+    return make_uniq<LzmaDecompressor>();
+#else
+    throw IOException("duckdb-zipfs was not built with lzma support.");
+#endif
+  case ZIP_METHOD_ZSTD:
+#ifdef ENABLE_ZSTD
+    return make_uniq<ZstdDecompressor>();
+#else
+    throw IOException("duckdb-zipfs was not built with zstd support.");
+#endif
+  default:
+    throw IOException("Unknown compression method");
+  }
+}
+
+} // namespace duckdb
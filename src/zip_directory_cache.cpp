@@ -0,0 +1,653 @@
+#include "zip_directory_cache.hpp"
+#include "zip_file_system.hpp"
+#include "utils.hpp"
+#include "zip_decompressor.hpp"
+#include "zip_index.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/limits.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/hash.hpp"
+
+#include <cstring>
+#include <ctime>
+
+namespace duckdb {
+
+//------------------------------------------------------------------------------
+// Zip Directory
+//------------------------------------------------------------------------------
+
+// Records of the central directory and its end, in the layout of the zip
+// specification (APPNOTE.TXT)
+static constexpr uint32_t ZIP_EOCD_SIGNATURE = 0x06054b50;
+static constexpr idx_t ZIP_EOCD_SIZE = 22;
+static constexpr uint32_t ZIP64_EOCD_LOCATOR_SIGNATURE = 0x07064b50;
+static constexpr idx_t ZIP64_EOCD_LOCATOR_SIZE = 20;
+static constexpr uint32_t ZIP64_EOCD_SIGNATURE = 0x06064b50;
+static constexpr idx_t ZIP64_EOCD_SIZE = 56;
+static constexpr uint32_t ZIP_CDIR_HEADER_SIGNATURE = 0x02014b50;
+static constexpr idx_t ZIP_CDIR_HEADER_SIZE = 46;
+static constexpr uint16_t ZIP64_EXTRA_FIELD_ID = 0x0001;
+static constexpr uint16_t ZIP_FLAG_ENCRYPTED = 0x0001;
+static constexpr uint16_t ZIP_FLAG_STRONG_ENCRYPTION = 0x0040;
+static constexpr uint32_t ZIP_DOS_DIRECTORY_ATTRIBUTE = 0x10;
+
+[[noreturn]] static void ThrowNotZip(const char *reason) {
+  throw IOException("Could not open as zip file: %s", reason);
+}
+
+// Convert an MS-DOS date and time, which are in local time
+static time_t DosTimeToTime(uint32_t dos_date_time) {
+  auto dos_date = dos_date_time >> 16;
+  auto dos_time = dos_date_time & 0xFFFF;
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_isdst = -1;
+  tm.tm_year = static_cast<int>(((dos_date >> 9) & 127) + 1980 - 1900);
+  tm.tm_mon = static_cast<int>(((dos_date >> 5) & 15) - 1);
+  tm.tm_mday = static_cast<int>(dos_date & 31);
+  tm.tm_hour = static_cast<int>((dos_time >> 11) & 31);
+  tm.tm_min = static_cast<int>((dos_time >> 5) & 63);
+  tm.tm_sec = static_cast<int>((dos_time << 1) & 62);
+  return mktime(&tm);
+}
+
+// Replace the sizes and offset saturated at 0xFFFFFFFF with those in the
+// zip64 extra field, which holds only the saturated ones, in this order
+static void ReadZip64ExtraField(const data_t *extra, idx_t extra_len,
+                                idx_t &uncomp_size, idx_t &comp_size,
+                                idx_t &local_header_ofs) {
+  const idx_t saturated = NumericLimits<uint32_t>::Maximum();
+  idx_t pos = 0;
+  while (pos + 4 <= extra_len) {
+    auto id = LoadLE16(extra + pos);
+    idx_t field_len = LoadLE16(extra + pos + 2);
+    pos += 4;
+    if (pos + field_len > extra_len) {
+      ThrowNotZip("invalid header or archive is corrupted");
+    }
+    if (id == ZIP64_EXTRA_FIELD_ID) {
+      auto field = extra + pos;
+      idx_t field_pos = 0;
+      for (auto value : {&uncomp_size, &comp_size, &local_header_ofs}) {
+        if (*value != saturated) {
+          continue;
+        }
+        if (field_pos + 8 > field_len) {
+          ThrowNotZip("invalid header or archive is corrupted");
+        }
+        *value = LoadLE64(field + field_pos);
+        field_pos += 8;
+      }
+      return;
+    }
+    pos += field_len;
+  }
+}
+
+// Order names as std::string does
+static bool NameLess(const char *a, idx_t a_len, const char *b, idx_t b_len) {
+  auto cmp = memcmp(a, b, MinValue(a_len, b_len));
+  return cmp < 0 || (cmp == 0 && a_len < b_len);
+}
+
+shared_ptr<ZipDirectory> ZipDirectory::Read(FileHandle &handle,
+                                            idx_t tail_size) {
+  if (!handle.CanSeek()) {
+    throw IOException("Cannot seek");
+  }
+
+  idx_t size = handle.GetFileSize();
+  ZipArchiveReader reader(handle, tail_size);
+  if (size < ZIP_EOCD_SIZE) {
+    ThrowNotZip("not a ZIP archive");
+  }
+
+  // The end of central directory record is followed only by a comment of up
+  // to 64 KiB, so search for it backwards from the end
+  auto search_len =
+      MinValue(size, ZIP_EOCD_SIZE + NumericLimits<uint16_t>::Maximum());
+  auto search_start = size - search_len;
+  auto search = make_uniq_array2<data_t>(search_len);
+  reader.Read(search.get(), search_len, search_start);
+  idx_t eocd_pos = search_len - ZIP_EOCD_SIZE + 1;
+  while (eocd_pos > 0) {
+    eocd_pos--;
+    if (LoadLE32(search.get() + eocd_pos) == ZIP_EOCD_SIGNATURE) {
+      break;
+    }
+    if (eocd_pos == 0) {
+      ThrowNotZip("failed finding central directory");
+    }
+  }
+  auto eocd = search.get() + eocd_pos;
+  auto eocd_ofs = search_start + eocd_pos;
+  idx_t disk_number = LoadLE16(eocd + 4);
+  idx_t cdir_disk = LoadLE16(eocd + 6);
+  idx_t entries_on_disk = LoadLE16(eocd + 8);
+  idx_t entry_count = LoadLE16(eocd + 10);
+  idx_t cdir_size = LoadLE32(eocd + 12);
+  idx_t cdir_ofs = LoadLE32(eocd + 16);
+
+  // Archives too large for those fields have a zip64 record with the full
+  // values, found by a locator right before the end of central directory
+  if (eocd_ofs >= ZIP64_EOCD_LOCATOR_SIZE) {
+    data_t locator[ZIP64_EOCD_LOCATOR_SIZE];
+    reader.Read(locator, ZIP64_EOCD_LOCATOR_SIZE,
+                eocd_ofs - ZIP64_EOCD_LOCATOR_SIZE);
+    if (LoadLE32(locator) == ZIP64_EOCD_LOCATOR_SIGNATURE) {
+      auto zip64_ofs = LoadLE64(locator + 8);
+      if (size < ZIP64_EOCD_SIZE || zip64_ofs > size - ZIP64_EOCD_SIZE) {
+        ThrowNotZip("invalid header or archive is corrupted");
+      }
+      data_t zip64_eocd[ZIP64_EOCD_SIZE];
+      reader.Read(zip64_eocd, ZIP64_EOCD_SIZE, zip64_ofs);
+      if (LoadLE32(zip64_eocd) != ZIP64_EOCD_SIGNATURE) {
+        ThrowNotZip("invalid header or archive is corrupted");
+      }
+      disk_number = LoadLE32(zip64_eocd + 16);
+      cdir_disk = LoadLE32(zip64_eocd + 20);
+      entries_on_disk = LoadLE64(zip64_eocd + 24);
+      entry_count = LoadLE64(zip64_eocd + 32);
+      cdir_size = LoadLE64(zip64_eocd + 40);
+      cdir_ofs = LoadLE64(zip64_eocd + 48);
+    }
+  }
+
+  // Archives split in one part are numbered as disk 0 or 1
+  if (entries_on_disk != entry_count || disk_number > 1 || cdir_disk > 1) {
+    ThrowNotZip("unsupported multidisk archive");
+  }
+  if (entry_count >= NumericLimits<uint32_t>::Maximum()) {
+    ThrowNotZip("too many files");
+  }
+  if (cdir_size < entry_count * ZIP_CDIR_HEADER_SIZE || cdir_ofs > size ||
+      cdir_size > size - cdir_ofs) {
+    ThrowNotZip("invalid header or archive is corrupted");
+  }
+
+  auto cdir = make_uniq_array2<data_t>(cdir_size);
+  if (cdir_size > 0) {
+    reader.Read(cdir.get(), cdir_size, cdir_ofs);
+  }
+
+  auto result = make_shared_ptr<ZipDirectory>();
+  result->ParseEntries(cdir.get(), cdir_size, entry_count, size);
+  result->SetEntryEnds(size);
+  result->BuildIndexes();
+  return result;
+}
+
+// Whether an entry's sizes and offset fit each other and the archive, which
+// reads of the entry rely on
+static bool IsValidEntry(idx_t local_header_ofs, idx_t comp_size,
+                         idx_t uncomp_size, uint16_t method, bool encrypted,
+                         idx_t archive_size) {
+  // Encrypted entries, which cannot be read, are only listed. Their data is
+  // preceded by an encryption header, so stored ones are larger than their
+  // contents.
+  return local_header_ofs <= archive_size && comp_size <= archive_size &&
+         ZIP_LOCAL_HEADER_SIZE + comp_size <=
+             archive_size - local_header_ofs &&
+         (method != ZIP_METHOD_STORED || encrypted ||
+          comp_size == uncomp_size) &&
+         (uncomp_size == 0 || comp_size > 0);
+}
+
+void ZipDirectory::ParseEntries(const data_t *data, idx_t len, idx_t count,
+                                idx_t archive_size) {
+  // Everything but the fixed size headers is an upper bound of the names
+  names.reserve(len - count * ZIP_CDIR_HEADER_SIZE);
+  name_offsets.reserve(count + 1);
+  local_header_offsets.reserve(count);
+  comp_sizes.reserve(count);
+  uncomp_sizes.reserve(count);
+  crc32s.reserve(count);
+  dos_times.reserve(count);
+  methods.reserve(count);
+  flags.reserve(count);
+
+  name_offsets.push_back(0);
+  idx_t pos = 0;
+  for (idx_t i = 0; i < count; i++) {
+    if (len - pos < ZIP_CDIR_HEADER_SIZE) {
+      ThrowNotZip("invalid header or archive is corrupted");
+    }
+    auto header = data + pos;
+    if (LoadLE32(header) != ZIP_CDIR_HEADER_SIGNATURE) {
+      ThrowNotZip("invalid header or archive is corrupted");
+    }
+    auto bit_flags = LoadLE16(header + 8);
+    auto method = LoadLE16(header + 10);
+    auto dos_time = LoadLE32(header + 12);
+    auto crc = LoadLE32(header + 16);
+    idx_t comp_size = LoadLE32(header + 20);
+    idx_t uncomp_size = LoadLE32(header + 24);
+    idx_t name_len = LoadLE16(header + 28);
+    idx_t extra_len = LoadLE16(header + 30);
+    idx_t comment_len = LoadLE16(header + 32);
+    auto external_attr = LoadLE32(header + 38);
+    idx_t local_header_ofs = LoadLE32(header + 42);
+    auto record_len = ZIP_CDIR_HEADER_SIZE + name_len + extra_len + comment_len;
+    if (len - pos < record_len) {
+      ThrowNotZip("invalid header or archive is corrupted");
+    }
+    auto name = reinterpret_cast<const char *>(header + ZIP_CDIR_HEADER_SIZE);
+    ReadZip64ExtraField(header + ZIP_CDIR_HEADER_SIZE + name_len, extra_len,
+                        uncomp_size, comp_size, local_header_ofs);
+    auto encrypted =
+        (bit_flags & (ZIP_FLAG_ENCRYPTED | ZIP_FLAG_STRONG_ENCRYPTION)) != 0;
+    if (!IsValidEntry(local_header_ofs, comp_size, uncomp_size, method,
+                      encrypted, archive_size)) {
+      ThrowNotZip("invalid header or archive is corrupted");
+    }
+
+    uint8_t entry_flags = 0;
+    // Some archivers mark directories only by their attributes
+    if ((name_len > 0 && name[name_len - 1] == '/') ||
+        (external_attr & ZIP_DOS_DIRECTORY_ATTRIBUTE)) {
+      entry_flags |= ZIP_ENTRY_IS_DIRECTORY;
+    }
+    if (encrypted) {
+      entry_flags |= ZIP_ENTRY_IS_ENCRYPTED;
+    }
+
+    names.append(name, name_len);
+    name_offsets.push_back(names.size());
+    local_header_offsets.push_back(local_header_ofs);
+    comp_sizes.push_back(comp_size);
+    uncomp_sizes.push_back(uncomp_size);
+    crc32s.push_back(crc);
+    dos_times.push_back(dos_time);
+    methods.push_back(method);
+    flags.push_back(entry_flags);
+    pos += record_len;
+  }
+  names.shrink_to_fit();
+}
+
+// Bound where each entry ends by the start of the entry after it. The last
+// entry is bounded by the largest header it can have instead.
+void ZipDirectory::SetEntryEnds(idx_t archive_size) {
+  vector<idx_t> order(EntryCount());
+  for (idx_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](idx_t a, idx_t b) {
+    return local_header_offsets[a] < local_header_offsets[b];
+  });
+  end_offsets.resize(EntryCount());
+  for (idx_t i = 0; i < order.size(); i++) {
+    auto idx = order[i];
+    auto start = local_header_offsets[idx];
+    auto max_end = start + ZIP_LOCAL_HEADER_SIZE +
+                   2 * NumericLimits<uint16_t>::Maximum() + comp_sizes[idx] +
+                   ZIP_DATA_DESCRIPTOR_SIZE;
+    auto next_start = i + 1 < order.size()
+                          ? local_header_offsets[order[i + 1]]
+                          : archive_size;
+    end_offsets[idx] = MaxValue(MinValue(max_end, next_start), start);
+  }
+}
+
+static char FoldCase(char c) {
+  return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+}
+
+// Hash of the name with ASCII letters folded to lower case
+static hash_t FoldedHash(const char *name, idx_t name_len) {
+  hash_t hash = 14695981039346656037ULL;
+  for (idx_t i = 0; i < name_len; i++) {
+    hash = (hash ^ uint8_t(FoldCase(name[i]))) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+hash_t ZipDirectory::NameHash(const char *name, idx_t name_len,
+                              bool fold_case) {
+  return fold_case ? FoldedHash(name, name_len) : Hash(name, name_len);
+}
+
+void ZipDirectory::BuildHashSlots(vector<uint32_t> &slots, bool fold_case) {
+  auto count = EntryCount();
+  idx_t slot_count = 16;
+  while (slot_count < 2 * count) {
+    slot_count *= 2;
+  }
+  slots.assign(slot_count, 0);
+  for (idx_t i = 0; i < count; i++) {
+    auto name = GetNameData(i);
+    auto name_len = GetNameLength(i);
+    auto slot = NameHash(name, name_len, fold_case) & (slot_count - 1);
+    bool duplicate = false;
+    while (slots[slot] != 0) {
+      if (NameEquals(slots[slot] - 1, name, name_len, fold_case)) {
+        // Lookups find the first of several entries with the same name
+        duplicate = true;
+        break;
+      }
+      slot = (slot + 1) & (slot_count - 1);
+    }
+    if (!duplicate) {
+      slots[slot] = NumericCast<uint32_t>(i + 1);
+    }
+  }
+}
+
+optional_idx ZipDirectory::FindSlot(const vector<uint32_t> &slots,
+                                    const char *name, idx_t name_len,
+                                    bool fold_case) const {
+  auto slot_mask = slots.size() - 1;
+  auto slot = NameHash(name, name_len, fold_case) & slot_mask;
+  while (slots[slot] != 0) {
+    idx_t idx = slots[slot] - 1;
+    if (NameEquals(idx, name, name_len, fold_case)) {
+      return idx;
+    }
+    slot = (slot + 1) & slot_mask;
+  }
+  return optional_idx();
+}
+
+void ZipDirectory::BuildIndexes() {
+  auto count = EntryCount();
+  BuildHashSlots(hash_slots, false);
+  BuildHashSlots(folded_hash_slots, true);
+
+  sorted_index.resize(count);
+  for (idx_t i = 0; i < count; i++) {
+    sorted_index[i] = NumericCast<uint32_t>(i);
+  }
+  std::sort(sorted_index.begin(), sorted_index.end(),
+            [&](uint32_t a, uint32_t b) {
+              return NameLess(GetNameData(a), GetNameLength(a),
+                              GetNameData(b), GetNameLength(b));
+            });
+}
+
+bool ZipDirectory::NameEquals(idx_t idx, const char *name, idx_t name_len,
+                              bool fold_case) const {
+  if (GetNameLength(idx) != name_len) {
+    return false;
+  }
+  auto data = GetNameData(idx);
+  if (!fold_case) {
+    return memcmp(data, name, name_len) == 0;
+  }
+  for (idx_t i = 0; i < name_len; i++) {
+    if (FoldCase(data[i]) != FoldCase(name[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ZipDirectoryEntry ZipDirectory::GetEntry(idx_t idx) const {
+  ZipDirectoryEntry entry;
+  entry.name = GetName(idx);
+  entry.local_header_ofs = local_header_offsets[idx];
+  entry.end_ofs = end_offsets[idx];
+  entry.comp_size = comp_sizes[idx];
+  entry.uncomp_size = uncomp_sizes[idx];
+  entry.crc32 = crc32s[idx];
+  entry.method = methods[idx];
+  entry.time = DosTimeToTime(dos_times[idx]);
+  entry.is_directory = IsDirectory(idx);
+  entry.is_encrypted = IsEncrypted(idx);
+  return entry;
+}
+
+optional_idx ZipDirectory::Find(const string &name) const {
+  auto idx = FindSlot(hash_slots, name.c_str(), name.size(), false);
+  if (idx.IsValid()) {
+    return idx;
+  }
+  // Names are matched ignoring case when there is no exact match, as miniz
+  // does
+  return FindSlot(folded_hash_slots, name.c_str(), name.size(), true);
+}
+
+vector<idx_t> ZipDirectory::FindPrefix(const string &prefix) const {
+  auto begin = std::lower_bound(
+      sorted_index.begin(), sorted_index.end(), prefix,
+      [&](uint32_t idx, const string &value) {
+        return NameLess(GetNameData(idx), GetNameLength(idx), value.c_str(),
+                        value.size());
+      });
+  vector<idx_t> result;
+  for (auto it = begin; it != sorted_index.end(); it++) {
+    if (GetNameLength(*it) < prefix.size() ||
+        memcmp(GetNameData(*it), prefix.c_str(), prefix.size()) != 0) {
+      break;
+    }
+    result.push_back(*it);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+template <class T>
+static idx_t VectorMemoryUsage(const vector<T> &values) {
+  return values.capacity() * sizeof(T);
+}
+
+idx_t ZipDirectory::MemoryUsage() const {
+  return sizeof(ZipDirectory) + names.capacity() +
+         VectorMemoryUsage(name_offsets) +
+         VectorMemoryUsage(local_header_offsets) +
+         VectorMemoryUsage(end_offsets) + VectorMemoryUsage(comp_sizes) +
+         VectorMemoryUsage(uncomp_sizes) + VectorMemoryUsage(crc32s) +
+         VectorMemoryUsage(dos_times) + VectorMemoryUsage(methods) +
+         VectorMemoryUsage(flags) + VectorMemoryUsage(hash_slots) +
+         VectorMemoryUsage(folded_hash_slots) +
+         VectorMemoryUsage(sorted_index);
+}
+
+// Index files start with a magic number and a format version. The columns
+// follow in native byte order, which is little-endian on every platform
+// DuckDB supports. Lookup indexes are rebuilt when the file is read.
+static constexpr char ZIP_INDEX_MAGIC[] = "ZIPFSIDX";
+static constexpr idx_t ZIP_INDEX_MAGIC_SIZE = 8;
+static constexpr uint32_t ZIP_INDEX_VERSION = 1;
+
+template <class T>
+static void WriteColumn(string &out, const T *values, idx_t count) {
+  out.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+}
+
+template <class T> static void WriteValue(string &out, T value) {
+  WriteColumn(out, &value, 1);
+}
+
+// Reads from an index file, failing once it runs out of data
+struct ZipIndexReader {
+  const data_t *data;
+  idx_t remaining;
+
+  template <class T> bool ReadColumn(vector<T> &values, idx_t count) {
+    if (count > remaining / sizeof(T)) {
+      return false;
+    }
+    values.resize(count);
+    if (count > 0) {
+      memcpy(values.data(), data, count * sizeof(T));
+    }
+    data += count * sizeof(T);
+    remaining -= count * sizeof(T);
+    return true;
+  }
+
+  template <class T> bool ReadValue(T &value) {
+    if (remaining < sizeof(T)) {
+      return false;
+    }
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    remaining -= sizeof(T);
+    return true;
+  }
+
+  bool ReadString(string &value, idx_t len) {
+    if (len > remaining) {
+      return false;
+    }
+    value.assign(reinterpret_cast<const char *>(data), len);
+    data += len;
+    remaining -= len;
+    return true;
+  }
+};
+
+void ZipDirectory::Serialize(const string &archive_key, string &out) const {
+  auto count = EntryCount();
+  out.append(ZIP_INDEX_MAGIC, ZIP_INDEX_MAGIC_SIZE);
+  WriteValue<uint32_t>(out, ZIP_INDEX_VERSION);
+  WriteValue<uint64_t>(out, archive_key.size());
+  out += archive_key;
+  WriteValue<uint64_t>(out, count);
+  WriteValue<uint64_t>(out, names.size());
+  out += names;
+  WriteColumn(out, name_offsets.data(), count + 1);
+  WriteColumn(out, local_header_offsets.data(), count);
+  WriteColumn(out, end_offsets.data(), count);
+  WriteColumn(out, comp_sizes.data(), count);
+  WriteColumn(out, uncomp_sizes.data(), count);
+  WriteColumn(out, crc32s.data(), count);
+  WriteColumn(out, dos_times.data(), count);
+  WriteColumn(out, methods.data(), count);
+  WriteColumn(out, flags.data(), count);
+}
+
+shared_ptr<ZipDirectory> ZipDirectory::Deserialize(const data_t *data,
+                                                   idx_t len,
+                                                   const string &archive_key,
+                                                   idx_t archive_size) {
+  ZipIndexReader reader{data, len};
+  string magic;
+  uint32_t version;
+  uint64_t key_len;
+  string key;
+  uint64_t count;
+  uint64_t names_len;
+  if (!reader.ReadString(magic, ZIP_INDEX_MAGIC_SIZE) ||
+      magic != ZIP_INDEX_MAGIC || !reader.ReadValue(version) ||
+      version != ZIP_INDEX_VERSION || !reader.ReadValue(key_len) ||
+      !reader.ReadString(key, key_len) || key != archive_key ||
+      !reader.ReadValue(count) ||
+      count >= NumericLimits<uint32_t>::Maximum() ||
+      !reader.ReadValue(names_len)) {
+    return nullptr;
+  }
+
+  auto result = make_shared_ptr<ZipDirectory>();
+  if (!reader.ReadString(result->names, names_len) ||
+      !reader.ReadColumn(result->name_offsets, count + 1) ||
+      !reader.ReadColumn(result->local_header_offsets, count) ||
+      !reader.ReadColumn(result->end_offsets, count) ||
+      !reader.ReadColumn(result->comp_sizes, count) ||
+      !reader.ReadColumn(result->uncomp_sizes, count) ||
+      !reader.ReadColumn(result->crc32s, count) ||
+      !reader.ReadColumn(result->dos_times, count) ||
+      !reader.ReadColumn(result->methods, count) ||
+      !reader.ReadColumn(result->flags, count) || reader.remaining != 0) {
+    return nullptr;
+  }
+  // Names are looked up through the offsets, which have to stay in bounds
+  auto &name_offsets = result->name_offsets;
+  if (name_offsets[0] != 0 || name_offsets[count] != names_len) {
+    return nullptr;
+  }
+  for (idx_t i = 0; i < count; i++) {
+    if (name_offsets[i] > name_offsets[i + 1]) {
+      return nullptr;
+    }
+  }
+  // As do the entries, as checked when parsing the archive
+  for (idx_t i = 0; i < count; i++) {
+    auto local_header_ofs = result->local_header_offsets[i];
+    if (!IsValidEntry(local_header_ofs, result->comp_sizes[i],
+                      result->uncomp_sizes[i], result->methods[i],
+                      result->IsEncrypted(i), archive_size) ||
+        result->end_offsets[i] < local_header_ofs ||
+        result->end_offsets[i] > archive_size) {
+      return nullptr;
+    }
+  }
+  result->BuildIndexes();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+// Zip Directory Cache
+//------------------------------------------------------------------------------
+
+// Read the directory from the archive's index if it has a current one, and
+// from the archive otherwise
+static shared_ptr<ZipDirectory> LoadDirectory(ClientContext &context,
+                                              FileHandle &handle,
+                                              const string &archive_key) {
+  if (GetBoolSetting(context, "zipfs_use_index", false)) {
+    auto directory = ReadZipIndex(context, handle, archive_key);
+    if (directory) {
+      return directory;
+    }
+  }
+  auto tail_size =
+      GetSizeSetting(context, "zipfs_tail_read_size", DEFAULT_TAIL_READ_SIZE);
+  return ZipDirectory::Read(handle, tail_size);
+}
+
+shared_ptr<ZipDirectory>
+ZipDirectoryCache::GetDirectory(ClientContext &context, FileHandle &handle) {
+  auto memory_limit = GetSizeSetting(context, "zipfs_directory_cache_size",
+                                     DEFAULT_DIRECTORY_CACHE_SIZE);
+  auto key = GetArchiveKey(handle);
+  if (memory_limit == 0) {
+    return LoadDirectory(context, handle, key);
+  }
+
+  {
+    lock_guard<mutex> guard(lock);
+    auto cached = lookup.find(key);
+    if (cached != lookup.end()) {
+      directories.splice(directories.begin(), directories, cached->second);
+      return cached->second->directory;
+    }
+  }
+
+  // Read without holding the lock, other archives can be looked up meanwhile
+  auto directory = LoadDirectory(context, handle, key);
+  auto directory_memory = directory->MemoryUsage();
+  if (directory_memory > memory_limit) {
+    return directory;
+  }
+
+  lock_guard<mutex> guard(lock);
+  if (lookup.find(key) == lookup.end()) {
+    directories.push_front(CachedDirectory{key, directory, directory_memory});
+    lookup[key] = directories.begin();
+    memory_usage += directory_memory;
+  }
+  EvictToLimit(memory_limit);
+  return directory;
+}
+
+void ZipDirectoryCache::EvictToLimit(idx_t memory_limit) {
+  while (memory_usage > memory_limit && !directories.empty()) {
+    auto &last = directories.back();
+    memory_usage -= last.memory_usage;
+    lookup.erase(last.key);
+    directories.pop_back();
+  }
+}
+
+void ZipDirectoryCache::Clear() {
+  lock_guard<mutex> guard(lock);
+  directories.clear();
+  lookup.clear();
+  memory_usage = 0;
+}
+
+} // namespace duckdb
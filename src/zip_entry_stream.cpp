@@ -0,0 +1,270 @@
+#include "zip_entry_stream.hpp"
+#include "utils.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+
+namespace duckdb {
+
+ZipEntryStream::ZipEntryStream(FileHandle &inner_handle,
+                               const ZipDirectoryEntry &entry,
+                               idx_t data_offset, idx_t checkpoint_interval,
+                               idx_t max_cursors)
+    : inner_handle(inner_handle), entry_name(entry.name),
+      data_offset(data_offset), comp_size(entry.comp_size),
+      uncomp_size(entry.uncomp_size), expected_crc(entry.crc32),
+      checkpoint_interval(checkpoint_interval), checkpoint_count(0),
+      cursor_count(0), max_cursors(MaxValue<idx_t>(max_cursors, 1)) {
+  if (checkpoint_interval > 0) {
+    // Checkpoints are spread further apart in large entries, so that they
+    // take at most ZIP_MAX_CHECKPOINTS * sizeof(ZipInflateState)
+    this->checkpoint_interval = MaxValue(
+        checkpoint_interval, uncomp_size / ZIP_MAX_CHECKPOINTS + 1);
+    checkpoint_count = uncomp_size / this->checkpoint_interval + 1;
+    checkpoints = make_uniq_array<atomic<ZipInflateState *>>(checkpoint_count);
+    for (idx_t i = 0; i < checkpoint_count; i++) {
+      checkpoints[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+}
+
+ZipEntryStream::~ZipEntryStream() {
+  for (idx_t i = 0; i < checkpoint_count; i++) {
+    delete checkpoints[i].load(std::memory_order_relaxed);
+  }
+}
+
+optional_ptr<ZipInflateState> ZipEntryStream::FindCheckpoint(idx_t location) {
+  if (checkpoint_count == 0) {
+    return nullptr;
+  }
+  // Checkpoints are never removed or changed once set, so they are read
+  // without taking a lock
+  auto slot = MinValue(location / checkpoint_interval, checkpoint_count - 1);
+  while (true) {
+    auto checkpoint = checkpoints[slot].load(std::memory_order_acquire);
+    if (checkpoint && checkpoint->out_pos <= location) {
+      return checkpoint;
+    }
+    if (slot == 0) {
+      return nullptr;
+    }
+    slot--;
+  }
+}
+
+void ZipEntryStream::AddCheckpoint(const ZipInflateState &state) {
+  if (checkpoint_count == 0) {
+    return;
+  }
+  auto slot = state.out_pos / checkpoint_interval;
+  if (slot == 0 || slot >= checkpoint_count ||
+      checkpoints[slot].load(std::memory_order_relaxed)) {
+    return;
+  }
+  // Another cursor may record one meanwhile, then the first is kept
+  auto checkpoint = make_uniq<ZipInflateState>(state);
+  ZipInflateState *expected = nullptr;
+  if (checkpoints[slot].compare_exchange_strong(expected, checkpoint.get(),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+    checkpoint.release();
+  }
+}
+
+unique_ptr<ZipStreamCursor> ZipEntryStream::AcquireCursor(idx_t location) {
+  std::unique_lock<mutex> guard(cursor_lock);
+  while (true) {
+    // Prefer the cursor which has least to inflate to get to the location
+    optional_idx closest;
+    for (idx_t i = 0; i < idle_cursors.size(); i++) {
+      auto start = idle_cursors[i]->chunk_start;
+      if (start <= location &&
+          (!closest.IsValid() ||
+           start > idle_cursors[closest.GetIndex()]->chunk_start)) {
+        closest = i;
+      }
+    }
+    if (!closest.IsValid() && cursor_count < max_cursors) {
+      cursor_count++;
+      guard.unlock();
+      auto cursor = make_uniq<ZipStreamCursor>();
+      cursor->input = BufferPool::Get().Allocate(ZIP_STREAM_INPUT_SIZE);
+      cursor->input_start = 0;
+      cursor->input_len = 0;
+      Restart(*cursor);
+      return cursor;
+    }
+    if (!closest.IsValid() && !idle_cursors.empty()) {
+      // All idle cursors are past the location, one of them has to go back
+      closest = idle_cursors.size() - 1;
+    }
+    if (closest.IsValid()) {
+      auto cursor = std::move(idle_cursors[closest.GetIndex()]);
+      idle_cursors.erase(idle_cursors.begin() + closest.GetIndex());
+      return cursor;
+    }
+    cursor_available.wait(guard);
+  }
+}
+
+void ZipEntryStream::ReleaseCursor(unique_ptr<ZipStreamCursor> cursor) {
+  {
+    lock_guard<mutex> guard(cursor_lock);
+    idle_cursors.push_back(std::move(cursor));
+  }
+  cursor_available.notify_one();
+}
+
+void ZipEntryStream::DiscardCursor() {
+  {
+    lock_guard<mutex> guard(cursor_lock);
+    cursor_count--;
+  }
+  cursor_available.notify_one();
+}
+
+void ZipEntryStream::Restart(ZipStreamCursor &cursor) {
+  if (!cursor.state) {
+    cursor.state = make_uniq<ZipInflateState>();
+  }
+  tinfl_init(&cursor.state->decomp);
+  cursor.state->dict_ofs = 0;
+  cursor.state->out_pos = 0;
+  cursor.state->comp_pos = 0;
+  cursor.chunk_start = 0;
+  cursor.chunk_ofs = 0;
+  cursor.chunk_len = 0;
+  cursor.done = false;
+  cursor.crc_valid = true;
+  cursor.crc = MZ_CRC32_INIT;
+}
+
+void ZipEntryStream::SeekTo(ZipStreamCursor &cursor, idx_t location) {
+  auto checkpoint = FindCheckpoint(location);
+
+  auto &state = *cursor.state;
+  auto behind = location < cursor.chunk_start;
+  auto closer = checkpoint && checkpoint->out_pos > state.out_pos;
+  if (behind || closer) {
+    if (checkpoint) {
+      state = *checkpoint;
+      cursor.chunk_start = state.out_pos;
+      cursor.chunk_len = 0;
+      cursor.done = false;
+      cursor.crc_valid = false;
+    } else {
+      Restart(cursor);
+    }
+  }
+
+  while (location >= cursor.chunk_start + cursor.chunk_len) {
+    Step(cursor);
+  }
+}
+
+void ZipEntryStream::Step(ZipStreamCursor &cursor) {
+  if (cursor.done) {
+    throw IOException("Unexpected end of compressed data in file: %s",
+                      entry_name);
+  }
+  auto &state = *cursor.state;
+
+  // Nothing is pending between steps, so this is a point inflation can be
+  // resumed from
+  AddCheckpoint(state);
+
+  while (true) {
+    auto comp_pos = state.comp_pos;
+    auto input_end = cursor.input_start + cursor.input_len;
+    if ((comp_pos < cursor.input_start || comp_pos >= input_end) &&
+        comp_pos < comp_size) {
+      cursor.input_len = MinValue(ZIP_STREAM_INPUT_SIZE, comp_size - comp_pos);
+      inner_handle.Read(cursor.input.get(), cursor.input_len,
+                        data_offset + comp_pos);
+      cursor.input_start = comp_pos;
+      input_end = cursor.input_start + cursor.input_len;
+    }
+    idx_t in_avail = 0;
+    const data_t *in_ptr = cursor.input.get();
+    if (comp_pos >= cursor.input_start && comp_pos < input_end) {
+      in_avail = input_end - comp_pos;
+      in_ptr += comp_pos - cursor.input_start;
+    }
+
+    size_t in_bytes = in_avail;
+    size_t out_bytes = TINFL_LZ_DICT_SIZE - state.dict_ofs;
+    mz_uint32 flags =
+        comp_pos + in_avail < comp_size ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+    auto status =
+        tinfl_decompress(&state.decomp, in_ptr, &in_bytes, state.dict,
+                         state.dict + state.dict_ofs, &out_bytes, flags);
+
+    state.comp_pos += in_bytes;
+    cursor.chunk_start = state.out_pos;
+    cursor.chunk_ofs = state.dict_ofs;
+    cursor.chunk_len = out_bytes;
+    state.out_pos += out_bytes;
+    state.dict_ofs = (state.dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+    if (cursor.crc_valid) {
+      cursor.crc = static_cast<uint32_t>(
+          mz_crc32(cursor.crc, state.dict + cursor.chunk_ofs, out_bytes));
+    }
+
+    if (status < TINFL_STATUS_DONE) {
+      throw IOException("Failed to inflate file within archive: %s",
+                        entry_name);
+    }
+    if (status == TINFL_STATUS_DONE) {
+      cursor.done = true;
+      if (state.out_pos != uncomp_size) {
+        throw IOException("Unexpected size of file within archive: %s",
+                          entry_name);
+      }
+      if (cursor.crc_valid && cursor.crc != expected_crc) {
+        throw IOException("CRC mismatch in file within archive: %s",
+                          entry_name);
+      }
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT &&
+               state.comp_pos >= comp_size) {
+      throw IOException("Unexpected end of compressed data in file: %s",
+                        entry_name);
+    }
+    if (cursor.chunk_len > 0 || cursor.done) {
+      return;
+    }
+  }
+}
+
+idx_t ZipEntryStream::Read(data_t *buffer, idx_t nr_bytes, idx_t location) {
+  if (location >= uncomp_size) {
+    return 0;
+  }
+  auto to_read = MinValue(nr_bytes, uncomp_size - location);
+
+  auto cursor = AcquireCursor(location);
+  idx_t total = 0;
+  try {
+    while (total < to_read) {
+      auto position = location + total;
+      if (position < cursor->chunk_start ||
+          position >= cursor->chunk_start + cursor->chunk_len) {
+        SeekTo(*cursor, position);
+      }
+      auto chunk_offset = position - cursor->chunk_start;
+      auto available =
+          MinValue(cursor->chunk_len - chunk_offset, to_read - total);
+      memcpy(buffer + total,
+             cursor->state->dict + cursor->chunk_ofs + chunk_offset,
+             available);
+      total += available;
+    }
+  } catch (...) {
+    DiscardCursor();
+    throw;
+  }
+  ReleaseCursor(std::move(cursor));
+  return total;
+}
+
+} // namespace duckdb
@@ -1,4 +1,9 @@
 #include "zip_file_system.hpp"
+#include "utils.hpp"
+#include "zip_decompressor.hpp"
+#include "buffer_pool.hpp"
+#include "archive_glob.hpp"
+#include "parallel_inflate.hpp"
 
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/numeric_utils.hpp"
@@ -8,16 +13,6 @@
 
 namespace duckdb {
 
-// TODO: Something is incorrect about the type in make_uniq_array<...,
-// std::default_delete<DATA_TYPE>, ...>
-template <class DATA_TYPE>
-inline unique_ptr<DATA_TYPE[], std::default_delete<DATA_TYPE[]>, true>
-make_uniq_array2(size_t n) // NOLINT: mimic std style
-{
-  return unique_ptr<DATA_TYPE[], std::default_delete<DATA_TYPE[]>, true>(
-      new DATA_TYPE[n]());
-}
-
 //------------------------------------------------------------------------------
 // Zip Utilities
 //------------------------------------------------------------------------------
@@ -93,12 +88,220 @@ static pair<string, string> SplitArchivePath(const string &path,
   }
 }
 
+// Get the length of an entry's local header, after which its data starts. The
+// local header's name and extra fields may differ in length from the central
+// directory's, so the header has to be read.
+static idx_t GetLocalHeaderSize(const data_t *header,
+                                const ZipDirectoryEntry &entry) {
+  if (LoadLE32(header) != 0x04034b50) {
+    throw IOException("Invalid local header for file within archive: %s",
+                      entry.name);
+  }
+  auto filename_len = LoadLE16(header + 26);
+  auto extra_len = LoadLE16(header + 28);
+  return ZIP_LOCAL_HEADER_SIZE + filename_len + extra_len;
+}
+
+static idx_t GetEntryDataOffset(FileHandle &handle,
+                                const ZipDirectoryEntry &entry) {
+  data_t header[ZIP_LOCAL_HEADER_SIZE];
+  handle.Read(header, ZIP_LOCAL_HEADER_SIZE, entry.local_header_ofs);
+  return entry.local_header_ofs + GetLocalHeaderSize(header, entry);
+}
+
+// Whether an entry is inflated on several threads when read into memory
+static bool InflatesInParallel(const ZipReadOptions &options,
+                               const ZipDirectoryEntry &entry) {
+  return entry.method == ZIP_METHOD_DEFLATE &&
+         CanInflateInParallel(entry.comp_size, options.inflate_threads);
+}
+
+// Decompress a whole compressed entry into out, which holds uncomp_size bytes
+static void DecompressEntry(const ZipReadOptions &options,
+                            BufferManager &buffer_manager,
+                            const data_t *comp_data,
+                            const ZipDirectoryEntry &entry, data_t *out) {
+  // Data which cannot be split between threads is inflated as usual
+  if (!InflatesInParallel(options, entry) ||
+      !ParallelInflate(buffer_manager, comp_data, entry.comp_size, out,
+                       entry.uncomp_size, options.inflate_threads)) {
+    auto decompressor =
+        ZipDecompressor::Create(entry.method, options.inflate_backend);
+    if (!decompressor->Decompress(comp_data, entry.comp_size, out,
+                                  entry.uncomp_size)) {
+      throw IOException("Failed to decompress file within archive: %s",
+                        entry.name);
+    }
+  }
+  auto crc = ZipCrc32(out, entry.uncomp_size);
+  if (crc != entry.crc32) {
+    throw IOException("CRC mismatch in file within archive: %s", entry.name);
+  }
+}
+
+// Decode an entry from its raw bytes, as planned by a glob, into out
+static void DecodeEntry(const ZipReadOptions &options,
+                        BufferManager &buffer_manager,
+                        const ZipEntryBytes &bytes,
+                        const ZipDirectoryEntry &entry, data_t *out) {
+  if (bytes.len < ZIP_LOCAL_HEADER_SIZE) {
+    throw IOException("Truncated file within archive: %s", entry.name);
+  }
+  auto header_size = GetLocalHeaderSize(bytes.data, entry);
+  if (header_size + entry.comp_size > bytes.len) {
+    throw IOException("Truncated file within archive: %s", entry.name);
+  }
+  auto comp_data = bytes.data + header_size;
+  if (entry.method == ZIP_METHOD_STORED) {
+    if (entry.comp_size != entry.uncomp_size) {
+      throw IOException("Invalid size of file within archive: %s", entry.name);
+    }
+    memcpy(out, comp_data, entry.comp_size);
+    if (ZipCrc32(out, entry.comp_size) != entry.crc32) {
+      throw IOException("CRC mismatch in file within archive: %s", entry.name);
+    }
+    return;
+  }
+  DecompressEntry(options, buffer_manager, comp_data, entry, out);
+}
+
+// Decompress an entry too large to hold in memory into a file in the temp
+// directory
+static unique_ptr<SpillFile> SpillEntry(const ZipReadOptions &options,
+                                        FileHandle &inner_handle,
+                                        const ZipDirectoryEntry &entry,
+                                        idx_t data_offset) {
+  auto spill_file = make_uniq<SpillFile>(options.spill);
+  uint32_t crc = 0;
+  auto output = [&](const data_t *buffer, idx_t nr_bytes) {
+    crc = ZipCrc32(buffer, nr_bytes, crc);
+    spill_file->Append(buffer, nr_bytes);
+  };
+
+  if (entry.method == ZIP_METHOD_DEFLATE) {
+    // Inflate front to back, so no checkpoints are needed
+    ZipEntryStream stream(inner_handle, entry, data_offset, 0, 1);
+    auto buffer = BufferPool::Get().Allocate(SPILL_CHUNK_SIZE);
+    idx_t position = 0;
+    while (position < entry.uncomp_size) {
+      auto read = stream.Read(buffer.get(), SPILL_CHUNK_SIZE, position);
+      output(buffer.get(), read);
+      position += read;
+    }
+  } else {
+    idx_t comp_pos = 0;
+    auto input = [&](data_t *buffer, idx_t nr_bytes) {
+      auto to_read = MinValue(nr_bytes, entry.comp_size - comp_pos);
+      inner_handle.Read(buffer, to_read, data_offset + comp_pos);
+      comp_pos += to_read;
+      return to_read;
+    };
+    auto decompressor =
+        ZipDecompressor::Create(entry.method, options.inflate_backend);
+    if (!decompressor->DecompressStreaming(input, entry.uncomp_size,
+                                           output)) {
+      throw IOException("Failed to decompress file within archive: %s",
+                        entry.name);
+    }
+  }
+
+  if (crc != entry.crc32) {
+    throw IOException("CRC mismatch in file within archive: %s", entry.name);
+  }
+  return spill_file;
+}
+
 //------------------------------------------------------------------------------
 // Zip File Handle
 //------------------------------------------------------------------------------
 
 void ZipFileHandle::Close() { inner_handle->Close(); }
 
+void ZipFileHandle::Load() {
+  lock_guard<mutex> guard(load_lock);
+  if (loaded) {
+    return;
+  }
+
+  if (!options.cache_key.empty()) {
+    auto cached = entry_cache->Get(options.cache_key);
+    if (cached) {
+      // The cached buffer may have been evicted since, then it is decompressed
+      // again below
+      pin = cached->Pin();
+      if (pin.IsValid()) {
+        data = std::move(cached);
+        loaded = true;
+        return;
+      }
+    }
+  }
+
+  // Large deflated entries are inflated as reads arrive, unless they are to
+  // be inflated on several threads, other large entries are decompressed to
+  // disk, and the rest into memory
+  auto streamed = entry.method == ZIP_METHOD_DEFLATE &&
+                  entry.uncomp_size > options.streaming_threshold &&
+                  (!InflatesInParallel(options, entry) ||
+                   options.spill.ShouldSpill(entry.uncomp_size));
+  auto spilled = !streamed && options.spill.ShouldSpill(entry.uncomp_size) &&
+                 (entry.method == ZIP_METHOD_DEFLATE ||
+                  ZipDecompressor::CanStream(entry.method));
+
+  ZipEntryBytes planned;
+  if (entry.uncomp_size <= options.streaming_threshold && !spilled &&
+      read_plan && read_plan->TryTake(*inner_handle, entry, planned)) {
+    // Part of a coalesced read planned by a glob
+    data = DecompressedEntry::Allocate(buffer_manager, entry.uncomp_size, pin);
+    DecodeEntry(options, buffer_manager, planned, entry, pin.Ptr());
+  } else {
+    data_offset = GetEntryDataOffset(*inner_handle, entry);
+    if (entry.method == ZIP_METHOD_STORED) {
+      // Stored entry: read the bytes in place, no buffering required
+    } else if (streamed) {
+      stream = make_uniq<ZipEntryStream>(*inner_handle, entry, data_offset,
+                                         options.checkpoint_interval,
+                                         options.stream_cursors);
+    } else if (spilled) {
+      spill_file = SpillEntry(options, *inner_handle, entry, data_offset);
+    } else {
+      auto comp_buf = BufferPool::Get().Allocate(entry.comp_size);
+      inner_handle->Read(comp_buf.get(), entry.comp_size, data_offset);
+      data =
+          DecompressedEntry::Allocate(buffer_manager, entry.uncomp_size, pin);
+      DecompressEntry(options, buffer_manager, comp_buf.get(), entry,
+                      pin.Ptr());
+    }
+  }
+
+  if (data && !options.cache_key.empty()) {
+    entry_cache->Put(options.cache_key, data, options.cache_size);
+  }
+  loaded = true;
+}
+
+idx_t ZipFileHandle::ReadAt(void *buffer, idx_t nr_bytes, idx_t location) {
+  if (location >= entry.uncomp_size) {
+    return 0;
+  }
+  if (!loaded) {
+    Load();
+  }
+  auto to_read = MinValue(nr_bytes, entry.uncomp_size - location);
+  if (stream) {
+    return stream->Read(static_cast<data_t *>(buffer), to_read, location);
+  }
+  if (spill_file) {
+    return spill_file->ReadAt(buffer, to_read, location);
+  }
+  if (!data) {
+    inner_handle->Read(buffer, to_read, data_offset + location);
+    return to_read;
+  }
+  memcpy(buffer, pin.Ptr() + location, to_read);
+  return to_read;
+}
+
 //------------------------------------------------------------------------------
 // Zip File System
 //------------------------------------------------------------------------------
@@ -108,16 +311,35 @@ bool ZipFileSystem::CanHandleFile(const string &fpath) {
   return fpath.size() > 6 && fpath.substr(0, 6) == "zip://";
 }
 
-size_t FileSystemZipReadFunc(void *pOpaque, mz_uint64 file_ofs, void *pBuf,
-                             size_t n) {
-  FileHandle *handle = (FileHandle *)pOpaque;
-  handle->Seek(UnsafeNumericCast<idx_t>(file_ofs));
-  return UnsafeNumericCast<size_t>(handle->Read(pBuf, n));
+ZipArchiveReader::ZipArchiveReader(FileHandle &handle, idx_t tail_size)
+    : handle(handle) {
+  auto size = handle.GetFileSize();
+  tail_len = MinValue(tail_size, size);
+  tail_start = size - tail_len;
+  tail = make_uniq_array2<data_t>(tail_len);
+  if (tail_len > 0) {
+    handle.Read(tail.get(), tail_len, tail_start);
+  }
+}
+
+void ZipArchiveReader::Read(data_t *buffer, idx_t nr_bytes, idx_t location) {
+  if (location >= tail_start && location + nr_bytes <= tail_start + tail_len) {
+    memcpy(buffer, tail.get() + (location - tail_start), nr_bytes);
+    return;
+  }
+  handle.Read(buffer, nr_bytes, location);
 }
 
 unique_ptr<FileHandle>
 ZipFileSystem::OpenFile(const string &path, FileOpenFlags flags,
                         optional_ptr<FileOpener> opener) {
+  return OpenFileExtended(OpenFileInfo(path), flags, opener);
+}
+
+unique_ptr<FileHandle>
+ZipFileSystem::OpenFileExtended(const OpenFileInfo &file, FileOpenFlags flags,
+                                optional_ptr<FileOpener> opener) {
+  const auto &path = file.path;
   if (!flags.OpenForReading() || flags.OpenForWriting()) {
     throw IOException("Zip file system can only open for reading");
   }
@@ -130,7 +352,9 @@ ZipFileSystem::OpenFile(const string &path, FileOpenFlags flags,
 
   // Now we need to find the file within the zip file and return out file handle
   auto &fs = FileSystem::GetFileSystem(*context);
-  auto handle = fs.OpenFile(zip_path, flags);
+  // The archive's info from a glob saves fetching it again, e.g. with an
+  // HTTP HEAD request
+  auto handle = fs.OpenFile(GetArchiveOpenInfo(zip_path, file), flags);
   if (!handle) {
     throw IOException("Failed to open file: %s", zip_path);
   }
@@ -147,78 +371,68 @@ ZipFileSystem::OpenFile(const string &path, FileOpenFlags flags,
     throw IOException("Cannot seek");
   }
 
-  idx_t size = handle->GetFileSize();
-
-  mz_zip_archive zip;
-  mz_zip_zero_struct(&zip);
-  zip.m_pRead = &FileSystemZipReadFunc;
-  zip.m_pIO_opaque = handle.get();
-  try {
-    mz_uint zip_flags = 0;
-
-    if (!mz_zip_reader_init(&zip, size, zip_flags)) {
-      throw IOException("Could not open as zip file: %s",
-                        mz_zip_get_error_string(mz_zip_get_last_error(&zip)));
-    }
-
-    mz_uint file_index = 0;
-    auto locate_failed =
-        mz_zip_reader_locate_file_v2(&zip, normalized_file_path.c_str(),
-                                     nullptr, 0, &file_index) == MZ_FALSE;
-    if (locate_failed) {
-      throw IOException("Failed to find file: %s", normalized_file_path);
-    }
-
-    mz_zip_archive_file_stat file_stat = {0};
-    auto stat_failed =
-        mz_zip_reader_file_stat(&zip, file_index, &file_stat) == MZ_FALSE;
-
-    if (stat_failed) {
-      throw IOException("Problem stat-ing file within archive: %s",
-                        mz_zip_get_error_string(mz_zip_get_last_error(&zip)));
-    }
-    if ((file_stat.m_method) && (file_stat.m_method != MZ_DEFLATED)) {
-      throw IOException("Unknown compression method");
-    }
-
-    auto read_buf = make_uniq_array2<data_t>(file_stat.m_uncomp_size);
-    mz_zip_reader_extract_file_to_mem(
-        &zip, file_stat.m_filename, read_buf.get(), file_stat.m_uncomp_size, 0);
-
-    auto zip_file_handle = make_uniq<ZipFileHandle>(
-        *this, path, flags, std::move(handle), file_stat, std::move(read_buf));
+  auto directory = directory_cache->GetDirectory(*context, *handle);
+  auto entry_idx = directory->Find(normalized_file_path);
+  if (!entry_idx.IsValid()) {
+    throw IOException("Failed to find file: %s", normalized_file_path);
+  }
+  auto entry = directory->GetEntry(entry_idx.GetIndex());
 
-    mz_zip_reader_end(&zip);
+  if (!ZipDecompressor::IsKnownMethod(entry.method)) {
+    throw IOException("Unknown compression method");
+  }
+  if (entry.is_encrypted) {
+    throw IOException("Encrypted files are not supported: %s",
+                      normalized_file_path);
+  }
 
-    return zip_file_handle;
-  } catch (Exception &ex) {
-    mz_zip_reader_end(&zip);
-    throw;
+  ZipReadOptions options;
+  options.streaming_threshold = GetSizeSetting(
+      *context, "zipfs_streaming_threshold", DEFAULT_STREAMING_THRESHOLD);
+  options.checkpoint_interval = GetSizeSetting(
+      *context, "zipfs_checkpoint_interval", DEFAULT_CHECKPOINT_INTERVAL);
+  options.stream_cursors = NumericCast<idx_t>(
+      TaskScheduler::GetScheduler(*context).NumberOfThreads());
+  options.inflate_threads =
+      GetBoolSetting(*context, "zipfs_parallel_inflate", false)
+          ? options.stream_cursors
+          : 1;
+  options.inflate_backend = GetStringSetting(*context, "zipfs_inflate_backend",
+                                             DEFAULT_INFLATE_BACKEND);
+  options.cache_size = GetSizeSetting(*context, "zipfs_entry_cache_size",
+                                      DEFAULT_ENTRY_CACHE_SIZE);
+  options.spill = GetSpillOptions(*context);
+  auto archive_key = GetArchiveKey(*handle);
+  if (options.cache_size > 0) {
+    options.cache_key =
+        archive_key + "\n" + entry.name + "\n" + std::to_string(entry.crc32);
   }
+  auto read_plan = ZipReadPlans::Get(*context).GetPlan(archive_key, false);
+  auto &buffer_manager = BufferManager::GetBufferManager(*context);
+  return make_uniq<ZipFileHandle>(*this, path, flags, std::move(handle),
+                                  std::move(read_plan), entry,
+                                  std::move(options), entry_cache,
+                                  buffer_manager);
 }
 
 void ZipFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes,
                          idx_t location) {
   auto &t_handle = handle.Cast<ZipFileHandle>();
-  auto remaining_bytes = t_handle.file_stat.m_uncomp_size - location;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + location, to_read);
+  t_handle.ReadAt(buffer, UnsafeNumericCast<idx_t>(nr_bytes), location);
 }
 
 int64_t ZipFileSystem::Read(FileHandle &handle, void *buffer,
                             int64_t nr_bytes) {
   auto &t_handle = handle.Cast<ZipFileHandle>();
-  auto position = t_handle.seek_offset;
-  auto remaining_bytes = t_handle.file_stat.m_uncomp_size - position;
-  auto to_read = MinValue(UnsafeNumericCast<idx_t>(nr_bytes), remaining_bytes);
-  memcpy(buffer, t_handle.data.get() + position, to_read);
-  t_handle.seek_offset += to_read;
-  return to_read;
+  auto read_bytes = t_handle.ReadAt(
+      buffer, UnsafeNumericCast<idx_t>(nr_bytes), t_handle.seek_offset);
+  t_handle.seek_offset += read_bytes;
+  return UnsafeNumericCast<int64_t>(read_bytes);
 }
 
 int64_t ZipFileSystem::GetFileSize(FileHandle &handle) {
   auto &t_handle = handle.Cast<ZipFileHandle>();
-  return UnsafeNumericCast<int64_t>(t_handle.file_stat.m_uncomp_size);
+  return UnsafeNumericCast<int64_t>(t_handle.entry.uncomp_size);
 }
 
 void ZipFileSystem::Seek(FileHandle &handle, idx_t location) {
@@ -282,138 +496,75 @@ vector<OpenFileInfo> ZipFileSystem::Glob(const string &path,
   auto extension =
       !zipfs_split_value.IsNull() ? zipfs_split_value.GetValue<string>() : "";
 
-  vector<OpenFileInfo> result;
-  for (const auto &curr_zip : matching_zips) {
+  auto coalesce_gap =
+      GetSizeSetting(*context, "zipfs_coalesce_gap", DEFAULT_COALESCE_GAP);
+  auto coalesce_max_size = GetSizeSetting(*context, "zipfs_coalesce_max_size",
+                                          DEFAULT_COALESCE_MAX_SIZE);
+  auto streaming_threshold = GetSizeSetting(
+      *context, "zipfs_streaming_threshold", DEFAULT_STREAMING_THRESHOLD);
+
+  const ArchiveGlob pattern(file_path);
+
+  // Scan archives in parallel, each into its own slot so that the result
+  // keeps the order of matching_zips
+  vector<vector<OpenFileInfo>> archive_results(matching_zips.size());
+  ParallelFor(*context, matching_zips.size(), [&](idx_t zip_idx) {
+    const auto &curr_zip = matching_zips[zip_idx];
+    auto &result = archive_results[zip_idx];
     if (!HasGlob(file_path)) {
       // No glob pattern in the file path, just return the file path
       result.push_back("zip://" + curr_zip.path + extension + ZIP_SEPARATOR +
                        file_path);
-      continue;
+      return;
     }
 
-    auto pattern_parts = StringUtil::Split(file_path, ZIP_SEPARATOR);
     // TODO: We may want to detect globbing into a nested zip file and reject.
 
     // Given the path to the zip file, open it
     auto archive_handle = fs.OpenFile(curr_zip, FileFlags::FILE_FLAGS_READ);
     if (!archive_handle) {
-      continue; // Skip invalid zip files
+      return; // Skip invalid zip files
     }
     if (!archive_handle->CanSeek()) {
-      continue; // Skip unseekable files
+      return; // Skip unseekable files
     }
 
-    idx_t size = archive_handle->GetFileSize();
-
-    mz_zip_archive zip;
-    mz_zip_zero_struct(&zip);
-    zip.m_pRead = &FileSystemZipReadFunc;
-    zip.m_pIO_opaque = archive_handle.get();
-
-    string zip_filename;
-    const size_t MAX_FILENAME_LEN = 65536; // = 2**16
-    zip_filename.reserve(1024);
-    try {
-      mz_uint flags = 0;
-
-      if (!mz_zip_reader_init(&zip, size, flags)) {
-        throw IOException("Could not open as zip file: %s",
-                          mz_zip_get_error_string(mz_zip_get_last_error(&zip)));
+    auto archive_info = GetArchiveInfo(curr_zip, *archive_handle);
+    auto directory = directory_cache->GetDirectory(*context, *archive_handle);
+    vector<ZipEntryRange> planned_entries;
+    for (auto entry_idx : directory->FindPrefix(pattern.GetLiteralPrefix())) {
+      if (directory->IsDirectory(entry_idx) ||
+          directory->IsEncrypted(entry_idx)) {
+        continue;
       }
 
-      mz_uint i, files;
-
-      files = mz_zip_reader_get_num_files(&zip);
-
-      for (i = 0; i < files; i++) {
-        mz_zip_clear_last_error(&zip);
-
-        if (mz_zip_reader_is_file_a_directory(&zip, i))
-          continue;
-
-        mz_zip_validate_file(&zip, i, MZ_ZIP_FLAG_VALIDATE_HEADERS_ONLY);
-
-        if (mz_zip_reader_is_file_encrypted(&zip, i))
-          continue;
-
-        mz_zip_clear_last_error(&zip);
-
-        mz_uint filename_size = mz_zip_reader_get_filename(&zip, i, nullptr, 0);
-        // NOTE: filename_size already contains +1 for the leading \0
-        // Double filename capacity/length until it's enough or larger than
-        // 2**16, where 2**16 should be the max filename length in zip files.
-        if (filename_size > zip_filename.capacity()) {
-          size_t new_capacity =
-              zip_filename.capacity() > 0 ? zip_filename.capacity() : 1;
-          while (new_capacity < filename_size) {
-            new_capacity *= 2;
-            if (new_capacity > MAX_FILENAME_LEN) {
-              throw IOException("Filename too long");
-            }
-          }
-          zip_filename.reserve(new_capacity);
-        }
-        zip_filename.resize(filename_size - 1);
-        mz_zip_reader_get_filename(&zip, i, &zip_filename[0], filename_size);
-
-        if (auto err = mz_zip_get_last_error(&zip)) {
-          throw IOException("Problem getting filename: %s",
-                            mz_zip_get_error_string(err));
-        }
-
-        auto entry_parts = StringUtil::Split(zip_filename, ZIP_SEPARATOR);
-
-        if (entry_parts.size() < pattern_parts.size()) {
-          // This entry is not deep enough to match the pattern
-          continue;
-        }
-
-        // Check if the pattern matches the entry
-        bool match = true;
-        for (idx_t i = 0; i < pattern_parts.size(); i++) {
-          const auto &pp = pattern_parts[i];
-          const auto &ep = entry_parts[i];
-
-          if (pp == "**") {
-            // We only allow crawl's to be at the end of the pattern
-            if (i != pattern_parts.size() - 1) {
-              throw NotImplementedException(
-                  "Recursive globs are only supported at the end of zip file "
-                  "path patterns");
-            }
-            // Otherwise, everything else is a match
-            match = true;
-            break;
-          }
-
-          if (!duckdb::Glob(ep.c_str(), ep.size(), pp.c_str(), pp.size())) {
-            // Not a match
-            match = false;
-            break;
-          }
-
-          if (i == pattern_parts.size() - 1 &&
-              entry_parts.size() > pattern_parts.size()) {
-            // If the entry is deeper than the pattern (and we havent hit a **),
-            // then it is not a match
-            match = false;
-            break;
-          }
-        }
-
-        if (match) {
-          auto entry_path = "zip://" + curr_zip.path + extension +
-                            ZIP_SEPARATOR + zip_filename;
-          // Cache here???
-          result.push_back(entry_path);
+      if (pattern.Match(directory->GetNameData(entry_idx),
+                        directory->GetNameLength(entry_idx))) {
+        auto uncomp_size = directory->GetUncompressedSize(entry_idx);
+        auto entry_path = "zip://" + curr_zip.path + extension +
+                          ZIP_SEPARATOR + directory->GetName(entry_idx);
+        result.push_back(MakeArchiveEntryInfo(entry_path, archive_info,
+                                              Value::UBIGINT(uncomp_size)));
+        if (uncomp_size <= streaming_threshold &&
+            ZipDecompressor::IsKnownMethod(directory->GetMethod(entry_idx))) {
+          planned_entries.push_back(
+              {directory->GetLocalHeaderOffset(entry_idx),
+               directory->GetEndOffset(entry_idx)});
         }
       }
-
-      mz_zip_reader_end(&zip);
-    } catch (Exception &ex) {
-      mz_zip_reader_end(&zip);
-      throw;
     }
+    if (coalesce_max_size > 0 && !planned_entries.empty()) {
+      auto read_plan = ZipReadPlans::Get(*context).GetPlan(
+          GetArchiveKey(*archive_handle), true);
+      read_plan->Plan(std::move(planned_entries), coalesce_gap,
+                      coalesce_max_size);
+    }
+  });
+
+  vector<OpenFileInfo> result;
+  for (auto &archive_result : archive_results) {
+    result.insert(result.end(), std::make_move_iterator(archive_result.begin()),
+                  std::make_move_iterator(archive_result.end()));
   }
 
   return result;
@@ -446,45 +597,23 @@ bool ZipFileSystem::FileExists(const string &filename,
     return false;
   }
 
-  idx_t size = handle->GetFileSize();
-
-  mz_zip_archive zip;
-  mz_zip_zero_struct(&zip);
-  zip.m_pRead = &FileSystemZipReadFunc;
-  zip.m_pIO_opaque = handle.get();
+  shared_ptr<ZipDirectory> directory;
   try {
-    mz_uint zip_flags = 0;
-
-    if (!mz_zip_reader_init(&zip, size, zip_flags)) {
-      return false;
-    }
-
-    mz_uint file_index = 0;
-    auto locate_failed =
-        mz_zip_reader_locate_file_v2(&zip, normalized_file_path.c_str(),
-                                     nullptr, 0, &file_index) == MZ_FALSE;
-    if (locate_failed) {
-      return false;
-    }
-
-    mz_zip_archive_file_stat file_stat = {0};
-    auto stat_failed =
-        mz_zip_reader_file_stat(&zip, file_index, &file_stat) == MZ_FALSE;
-
-    if (stat_failed) {
-      return false;
-    }
-    if ((file_stat.m_method) && (file_stat.m_method != MZ_DEFLATED)) {
-      return false;
-    }
-
-    mz_zip_reader_end(&zip);
+    directory = directory_cache->GetDirectory(*context, *handle);
+  } catch (IOException &ex) {
+    return false;
+  }
 
-    return true;
-  } catch (Exception &ex) {
-    mz_zip_reader_end(&zip);
-    throw;
+  auto entry_idx = directory->Find(normalized_file_path);
+  if (!entry_idx.IsValid()) {
+    return false;
   }
+  if (!ZipDecompressor::IsKnownMethod(
+          directory->GetMethod(entry_idx.GetIndex()))) {
+    return false;
+  }
+
+  return true;
 }
 
 } // namespace duckdb
@@ -0,0 +1,123 @@
+#include "zip_index.hpp"
+#include "zip_file_system.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+string GetZipIndexPath(ClientContext &context, const string &archive_path) {
+  auto index_directory =
+      GetStringSetting(context, "zipfs_index_directory", "");
+  if (index_directory.empty()) {
+    return archive_path + ZIP_INDEX_EXTENSION;
+  }
+  // Archives in different places may have the same name, so the name is
+  // prefixed by a hash of the whole path
+  auto &fs = FileSystem::GetFileSystem(context);
+  auto name = archive_path.substr(archive_path.find_last_of("/\\") + 1);
+  auto path_hash = Hash(archive_path.c_str(), archive_path.size());
+  return fs.JoinPath(index_directory, std::to_string(path_hash) + "_" + name +
+                                          ZIP_INDEX_EXTENSION);
+}
+
+shared_ptr<ZipDirectory> ReadZipIndex(ClientContext &context,
+                                      FileHandle &handle,
+                                      const string &archive_key) {
+  auto &fs = FileSystem::GetFileSystem(context);
+  auto index_path = GetZipIndexPath(context, handle.GetPath());
+  unique_ptr<FileHandle> index_handle;
+  try {
+    index_handle = fs.OpenFile(index_path,
+                               FileFlags::FILE_FLAGS_READ |
+                                   FileFlags::FILE_FLAGS_NULL_IF_NOT_EXISTS);
+  } catch (Exception &ex) {
+    // The index cannot be opened (e.g. no permission to read it), so read
+    // the archive's own central directory
+    return nullptr;
+  }
+  if (!index_handle) {
+    return nullptr;
+  }
+  auto size = index_handle->GetFileSize();
+  auto data = make_uniq_array2<data_t>(size);
+  if (size > 0) {
+    index_handle->Read(data.get(), size, 0);
+  }
+  return ZipDirectory::Deserialize(data.get(), size, archive_key,
+                                   handle.GetFileSize());
+}
+
+struct BuildZipIndexFunctionData : public GlobalTableFunctionState {
+  BuildZipIndexFunctionData() : finished(false) {}
+  bool finished;
+};
+
+struct BuildZipIndexFunctionBindData : public TableFunctionData {
+  string file_path;
+  shared_ptr<ZipDirectoryCache> directory_cache;
+};
+
+void BuildZipIndexFunction(ClientContext &context, TableFunctionInput &data,
+                           DataChunk &output) {
+  auto &bind_data = data.bind_data->Cast<BuildZipIndexFunctionBindData>();
+  auto &global_data = data.global_state->Cast<BuildZipIndexFunctionData>();
+  if (global_data.finished) {
+    return;
+  }
+  auto &zip_path = bind_data.file_path;
+
+  auto &fs = FileSystem::GetFileSystem(context);
+  auto handle = fs.OpenFile(zip_path, FileOpenFlags::FILE_FLAGS_READ);
+  if (!handle) {
+    throw IOException("Failed to open file: %s", zip_path);
+  }
+  if (!handle->CanSeek()) {
+    throw IOException("Cannot seek");
+  }
+
+  auto archive_key = GetArchiveKey(*handle);
+  auto directory = bind_data.directory_cache->GetDirectory(context, *handle);
+  string index;
+  directory->Serialize(archive_key, index);
+
+  auto index_path = GetZipIndexPath(context, handle->GetPath());
+  auto index_handle =
+      fs.OpenFile(index_path, FileFlags::FILE_FLAGS_WRITE |
+                                  FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+  index_handle->Write(const_cast<char *>(index.data()), index.size());
+  index_handle->Close();
+
+  output.SetValue(0, 0, Value(index_path));
+  output.SetValue(1, 0, Value::UBIGINT(directory->EntryCount()));
+  output.SetCardinality(1);
+  global_data.finished = true;
+}
+
+unique_ptr<FunctionData>
+BuildZipIndexFunctionBind(ClientContext &context,
+                          TableFunctionBindInput &input,
+                          vector<LogicalType> &return_types,
+                          vector<string> &names) {
+  auto result = make_uniq<BuildZipIndexFunctionBindData>();
+  result->file_path = input.inputs[0].GetValue<string>();
+  result->directory_cache =
+      input.info->Cast<ZipIndexFunctionInfo>().directory_cache;
+
+  return_types.push_back(LogicalType::VARCHAR);
+  names.emplace_back("index_path");
+
+  return_types.push_back(LogicalType::UBIGINT);
+  names.emplace_back("file_count");
+
+  return result;
+}
+
+unique_ptr<GlobalTableFunctionState>
+BuildZipIndexFunctionInit(ClientContext &context,
+                          TableFunctionInitInput &input) {
+  return std::move(make_uniq<BuildZipIndexFunctionData>());
+}
+
+} // namespace duckdb
@@ -0,0 +1,98 @@
+#include "zip_read_plan.hpp"
+#include "zip_directory_cache.hpp"
+#include "utils.hpp"
+
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+void ZipReadPlan::Plan(vector<ZipEntryRange> entries, idx_t max_gap,
+                       idx_t max_size) {
+  std::sort(entries.begin(), entries.end(),
+            [](const ZipEntryRange &a, const ZipEntryRange &b) {
+              return a.start < b.start;
+            });
+
+  unordered_map<idx_t, shared_ptr<ZipReadSegment>> segments;
+  shared_ptr<ZipReadSegment> current;
+  for (auto &entry : entries) {
+    auto start = entry.start;
+    auto end = entry.end;
+    if (end - start > max_size) {
+      // Too large to be worth buffering, read it on its own
+      continue;
+    }
+    if (!current || start > current->end + max_gap ||
+        end - current->start > max_size) {
+      current = make_shared_ptr<ZipReadSegment>();
+      current->start = start;
+      current->end = end;
+    } else {
+      current->end = MaxValue(current->end, end);
+    }
+    segments[start] = current;
+  }
+
+  lock_guard<mutex> guard(lock);
+  for (auto &segment : segments) {
+    planned[segment.first] = std::move(segment.second);
+  }
+}
+
+bool ZipReadPlan::TryTake(FileHandle &handle, const ZipDirectoryEntry &entry,
+                          ZipEntryBytes &result) {
+  shared_ptr<ZipReadSegment> segment;
+  {
+    lock_guard<mutex> guard(lock);
+    auto planned_entry = planned.find(entry.local_header_ofs);
+    if (planned_entry == planned.end()) {
+      return false;
+    }
+    segment = std::move(planned_entry->second);
+    planned.erase(planned_entry);
+  }
+
+  {
+    lock_guard<mutex> guard(segment->lock);
+    if (!segment->data) {
+      // Only kept once read, so a failed read is tried again by the next
+      // entry rather than leaving it garbage
+      auto len = segment->end - segment->start;
+      auto data = BufferPool::Get().Allocate(len);
+      handle.Read(data.get(), len, segment->start);
+      segment->data = std::move(data);
+    }
+  }
+
+  result.data = segment->data.get() + (entry.local_header_ofs - segment->start);
+  result.len = entry.end_ofs - entry.local_header_ofs;
+  result.segment = std::move(segment);
+  return true;
+}
+
+ZipReadPlans &ZipReadPlans::Get(ClientContext &context) {
+  return *context.registered_state->GetOrCreate<ZipReadPlans>(
+      "zipfs_read_plans");
+}
+
+shared_ptr<ZipReadPlan> ZipReadPlans::GetPlan(const string &archive_key,
+                                              bool create) {
+  lock_guard<mutex> guard(lock);
+  auto plan = plans.find(archive_key);
+  if (plan != plans.end()) {
+    return plan->second;
+  }
+  if (!create) {
+    return nullptr;
+  }
+  auto result = make_shared_ptr<ZipReadPlan>();
+  plans[archive_key] = result;
+  return result;
+}
+
+void ZipReadPlans::QueryEnd() {
+  lock_guard<mutex> guard(lock);
+  plans.clear();
+}
+
+} // namespace duckdb
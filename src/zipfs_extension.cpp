@@ -1,8 +1,12 @@
 #include "zipfs_extension.hpp"
 #include "zip_file_system.hpp"
+#include "zip_decompressor.hpp"
 #include "archive_file_system.hpp"
 #include "noop_archive_file_system.hpp"
 #include "zip_contents.hpp"
+#include "clear_cache.hpp"
+#include "buffer_pool.hpp"
+#include "zip_index.hpp"
 #include "archive_contents.hpp"
 #include "noop_archive_contents.hpp"
 #include "duckdb.hpp"
@@ -14,19 +18,51 @@
 
 namespace duckdb {
 
+static void SetInflateBackend(ClientContext &context, SetScope scope,
+                              Value &parameter) {
+  if (!parameter.IsNull()) {
+    ZipDecompressor::CheckInflateBackend(parameter.ToString());
+  }
+}
+
+static void SetBufferPoolSize(ClientContext &context, SetScope scope,
+                              Value &parameter) {
+  if (!parameter.IsNull()) {
+    BufferPool::Get().SetMaxIdleSize(parameter.GetValue<uint64_t>());
+  }
+}
+
 static void LoadInternal(ExtensionLoader &loader) {
   std::string description = "Support for reading files from zip archives";
   loader.SetDescription(description);
 
   auto &fs = loader.GetDatabaseInstance().GetFileSystem();
-  fs.RegisterSubSystem(make_uniq<ZipFileSystem>());
-  loader.RegisterFunction(TableFunction("zip_contents", {LogicalType::VARCHAR},
-                                        ReadZipFunction, ReadZipFunctionBind,
-                                        ReadZipFunctionInit));
+  auto directory_cache = make_shared_ptr<ZipDirectoryCache>();
+  auto entry_cache = make_shared_ptr<EntryCache>();
+  fs.RegisterSubSystem(make_uniq<ZipFileSystem>(directory_cache, entry_cache));
+  TableFunction zip_contents("zip_contents", {LogicalType::VARCHAR},
+                             ReadZipFunction, ReadZipFunctionBind,
+                             ReadZipFunctionInit);
+  zip_contents.function_info =
+      make_shared_ptr<ZipContentsFunctionInfo>(directory_cache);
+  loader.RegisterFunction(zip_contents);
+
+  TableFunction build_index("zipfs_build_index", {LogicalType::VARCHAR},
+                            BuildZipIndexFunction, BuildZipIndexFunctionBind,
+                            BuildZipIndexFunctionInit);
+  build_index.function_info =
+      make_shared_ptr<ZipIndexFunctionInfo>(directory_cache);
+  loader.RegisterFunction(build_index);
+
+  TableFunction clear_cache("zipfs_clear_cache", {}, ClearCacheFunction,
+                            ClearCacheFunctionBind, ClearCacheFunctionInit);
+  clear_cache.function_info =
+      make_shared_ptr<ClearCacheFunctionInfo>(directory_cache, entry_cache);
+  loader.RegisterFunction(clear_cache);
 
 #ifdef ENABLE_LIBARCHIVE
-  fs.RegisterSubSystem(make_uniq<ArchiveFileSystem>());
-  fs.RegisterSubSystem(make_uniq<RawArchiveFileSystem>());
+  fs.RegisterSubSystem(make_uniq<ArchiveFileSystem>(entry_cache));
+  fs.RegisterSubSystem(make_uniq<RawArchiveFileSystem>(entry_cache));
   loader.RegisterFunction(TableFunction(
       "archive_contents", {LogicalType::VARCHAR}, ReadArchiveFunction,
       ReadArchiveFunctionBind, ReadArchiveFunctionInit));
@@ -51,6 +87,96 @@ static void LoadInternal(ExtensionLoader &loader) {
       "the file path within the zip. Will be removed from the zip file name. "
       "Overrides zipfs_extension. Defaults to NULL.",
       LogicalType::VARCHAR, Value(LogicalType::VARCHAR));
+  config.AddExtensionOption(
+      "zipfs_streaming_threshold",
+      "Uncompressed size in bytes above which zip entries are inflated on "
+      "demand while reading, instead of entirely in memory when opened.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_STREAMING_THRESHOLD));
+  config.AddExtensionOption(
+      "zipfs_directory_cache_size",
+      "Memory budget in bytes for the cache of zip central directories shared "
+      "by globbing, opening and listing files. Set to 0 to disable.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_DIRECTORY_CACHE_SIZE));
+  config.AddExtensionOption(
+      "zipfs_tail_read_size",
+      "Number of bytes read from the end of a zip file in a single request "
+      "when opening it, which usually covers the whole central directory.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_TAIL_READ_SIZE));
+  config.AddExtensionOption(
+      "zipfs_checkpoint_interval",
+      "Distance in uncompressed bytes between the points recorded while "
+      "inflating a streamed zip entry, which later reads can resume from. "
+      "Set to 0 to disable.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_CHECKPOINT_INTERVAL));
+  config.AddExtensionOption(
+      "zipfs_coalesce_gap",
+      "Largest number of unneeded bytes between zip entries matched by a glob "
+      "that are read anyway to fetch the entries in a single request.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_COALESCE_GAP));
+  config.AddExtensionOption(
+      "zipfs_coalesce_max_size",
+      "Largest size in bytes of a single read covering several zip entries "
+      "matched by a glob. Set to 0 to disable coalescing reads.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_COALESCE_MAX_SIZE));
+  config.AddExtensionOption(
+      "zipfs_inflate_backend",
+      "Library used to inflate zip entries read entirely into memory: 'miniz', "
+      "'libdeflate' (if built with it) or 'auto' for the fastest available.",
+      LogicalType::VARCHAR, Value(DEFAULT_INFLATE_BACKEND),
+      SetInflateBackend);
+  config.AddExtensionOption(
+      "zipfs_parallel_inflate",
+      "Inflate large deflated zip entries and gzip files opened with "
+      "compressed:// on several threads, each starting at a guessed deflate "
+      "block. Data which cannot be split is inflated on one thread.",
+      LogicalType::BOOLEAN, Value::BOOLEAN(false));
+  config.AddExtensionOption(
+      "zipfs_parallel_members",
+      "Decompress compressed:// files made of several gzip members, bzip2 "
+      "blocks or zstd frames on several threads.",
+      LogicalType::BOOLEAN, Value::BOOLEAN(false));
+  config.AddExtensionOption(
+      "zipfs_mmap",
+      "Map local archives read with archive:// or compressed:// into memory "
+      "rather than reading them into buffers. A file truncated while mapped "
+      "crashes the process, so only enable this for files that do not change.",
+      LogicalType::BOOLEAN, Value::BOOLEAN(false));
+  config.AddExtensionOption(
+      "zipfs_stream_buffer_size",
+      "Size in bytes of the buffer of recent output kept while reading "
+      "compressed:// files as a stream, decompressing them as they are read "
+      "rather than whole when first read. Set to 0 to disable.",
+      LogicalType::UBIGINT, Value::UBIGINT(0));
+  config.AddExtensionOption(
+      "zipfs_entry_cache_size",
+      "Memory budget in bytes for the cache of decompressed files read from "
+      "archives, shared by all queries. Set to 0 to disable.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_ENTRY_CACHE_SIZE));
+  config.AddExtensionOption(
+      "zipfs_buffer_pool_size",
+      "Most memory in bytes held for reuse by the buffers of compressed data "
+      "shared by all databases in the process, outside of memory_limit. Set "
+      "to 0 to free buffers as soon as they are no longer used.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_BUFFER_POOL_SIZE),
+      SetBufferPoolSize);
+  config.AddExtensionOption(
+      "zipfs_spill_threshold",
+      "Files larger than this many bytes which would otherwise be "
+      "decompressed into memory are decompressed into the temp_directory "
+      "instead. Set to 0 to always use memory.",
+      LogicalType::UBIGINT, Value::UBIGINT(DEFAULT_SPILL_THRESHOLD));
+  config.AddExtensionOption(
+      "zipfs_use_index",
+      "Read the central directory of a zip file from the index written by "
+      "zipfs_build_index, if there is one for the current version of the "
+      "zip file. Off by default, as looking for the index takes an extra "
+      "request per zip file.",
+      LogicalType::BOOLEAN, Value::BOOLEAN(false));
+  config.AddExtensionOption(
+      "zipfs_index_directory",
+      "Directory holding the indexes written by zipfs_build_index. When "
+      "empty, each index is written next to its zip file.",
+      LogicalType::VARCHAR, Value(""));
 }
 
 void ZipfsExtension::Load(ExtensionLoader &loader) { LoadInternal(loader); }